@@ -324,7 +324,6 @@ void InsertButton::getState() {
             const auto& note = n.notes[index];
             if (note.isSelectable(ntw->selectChannels)) {   // use lambda for this pattern
                 span.push_back(note);
-                span.back().cache = nullptr;
             }
         }
         state = insertInPlace ? State::dupInPlace : selectButton->editStart() ?
@@ -340,7 +339,6 @@ void InsertButton::getState() {
             const auto& note = n.notes[index];
             if (NOTE_ON == note.type && note.isSelectable(ntw->selectChannels)) {
                 span.push_back(note);
-                span.back().cache = nullptr;
                 break;
             }
         }
@@ -350,7 +348,6 @@ void InsertButton::getState() {
             const auto& note = n.notes[index];
             if (NOTE_ON == note.type && note.isSelectable(ntw->selectChannels)) {
                 span.push_back(note);
-                span.back().cache = nullptr;
                 break;
             }
         }
@@ -418,7 +415,7 @@ void InsertButton::onDragEnd(const event::DragEnd& e) {
             DEBUG("** failed to transpose span");
             return;
         }
-        n.notes.insert(n.notes.begin() + insertLoc, span.begin(), span.end());
+        n.notes.insert(insertLoc, span);
     } else {
         if (slotOn) {
             ntw->storage.playback.insert(ntw->storage.playback.begin() + insertLoc, pspan.begin(),
@@ -429,7 +426,7 @@ void InsertButton::onDragEnd(const event::DragEnd& e) {
             if (Notes::ShiftNotes(span, 0, lastEndTime - span.front().startTime)) {
                 std::sort(span.begin(), span.end());
             }
-            n.notes.insert(n.notes.begin() + insertLoc, span.begin(), span.end());
+            n.notes.insert(insertLoc, span);
             // include notes on other channels that fit within the start/end window
            // shift by span duration less next start (if any) on same channel minus selectStart time
             shiftTime = (lastEndTime - insertTime)
@@ -463,7 +460,7 @@ void KeyButton::onDragEnd(const event::DragEnd& e) {
     shiftTime = duration = 0;
     onDragEndPreamble(e);
     DisplayNote keySignature(KEY_SIGNATURE);
-    n.notes.insert(n.notes.begin() + insertLoc, keySignature);
+    n.notes.insert(insertLoc, keySignature);
     shiftTime = duration = 0;
     AdderButton::onDragEnd(e);
 }
@@ -595,7 +592,7 @@ void RestButton::onDragEnd(const event::DragEnd& e) {
     onDragEndPreamble(e);
     DisplayNote rest(REST_TYPE, startTime, n.ppq, (uint8_t) ntw->unlockedChannel());
     shiftTime = rest.duration;
-    n.notes.insert(n.notes.begin() + insertLoc, rest);
+    n.notes.insert(insertLoc, rest);
     AdderButton::onDragEnd(e);
 }
 
@@ -609,10 +606,12 @@ void RunButton::onDragEnd(const event::DragEnd& e) {
     if (!this->ledOn()) {
         ntw->enableButtons();
         dynamicRunAlpha = 255;
+        ntw->sendSelection();
         nt->requests.push(RequestType::resetPlayStart);
     } else {
-        nt->requests.push(RequestType::resetAndPlay);
         ntw->resetForPlay();
+        ntw->sendSelection();
+        nt->requests.push(RequestType::resetAndPlay);
         ntw->turnOffLEDButtons(this, true);
         ntw->disableEmptyButtons();
         dynamicRunAlpha = 0;
@@ -760,7 +759,7 @@ void TempoButton::onDragEnd(const event::DragEnd& e) {
     shiftTime = duration = 0;
     onDragEndPreamble(e);
     DisplayNote tempo(MIDI_TEMPO, startTime);
-    n.notes.insert(n.notes.begin() + insertLoc, tempo);
+    n.notes.insert(insertLoc, tempo);
     shiftTime = duration = 0;
     AdderButton::onDragEnd(e);
 }
@@ -817,7 +816,7 @@ void TimeButton::onDragEnd(const event::DragEnd& e) {
     shiftTime = duration = 0;
     onDragEndPreamble(e);
     DisplayNote timeSignature(TIME_SIGNATURE, startTime);
-    n.notes.insert(n.notes.begin() + insertLoc, timeSignature);
+    n.notes.insert(insertLoc, timeSignature);
     shiftTime = duration = 0;
     AdderButton::onDragEnd(e);
 }
@@ -146,7 +146,7 @@ void BeamPosition::set(const vector<NoteCache>& notes) {
     }
 }
 
-CacheBuilder::CacheBuilder(const DisplayState& sd, Notes* n, DisplayCache* c) 
+CacheBuilder::CacheBuilder(const DisplayState& sd, const Notes* n, DisplayCache* c) 
     : state(sd)
     , notes(n)
     , cache(c) {
@@ -446,7 +446,7 @@ void CacheBuilder::cacheTuplets() {
     for (unsigned cacheIndex = 0; cacheIndex < cache->notes.size(); ++cacheIndex) {
         auto& entry = cache->notes[cacheIndex];
         unsigned noteIndex = entry.note - &notes->notes.front();
-        entry.tripletPosition = entry.note->triplet;
+        entry.tripletPosition = cache->triplets[noteIndex];
         auto beam = *beamPtr;
 #if DEBUG_TRIPLET_DRAW
         DEBUG("%s %s\n beam %s", __func__,
@@ -500,8 +500,8 @@ void CacheBuilder::cacheTuplets() {
                 DEBUG("%s rightBeamPtr %s", __func__, rightBeamPtr->debugString().c_str());
                 DEBUG("%s %s tripletId %u tuplet %u/%u", __func__, entry.note->debugString(notes->notes,
                         &cache->notes, &entry).c_str(), beamIds[chan],
-                        notes->notes[rightBeamPtr->noteFirst].triplet,
-                        notes->notes[rightBeamPtr->noteLast].triplet);
+                        cache->triplets[rightBeamPtr->noteFirst],
+                        cache->triplets[rightBeamPtr->noteLast]);
             }
             SCHMICKLE(rightBeamPtr->noteLast == noteIndex);
             rightBeamPtr->cacheLast = cacheIndex;
@@ -628,14 +628,13 @@ void CacheBuilder::setDurations() {
 #endif
     int ppq = notes->ppq;
     for (unsigned index = 0; index < notes->notes.size(); ++index) {
-        DisplayNote& note = notes->notes[index];
+        const DisplayNote& note = notes->notes[index];
         if (NOTE_OFF == note.type) {
-            SCHMICKLE(!note.cache);
             continue;
         }
         if (REST_TYPE == note.type) {
-            if (PositionType::none == note.triplet && !note.isSelectable(state.selectedChannels)) {
-                SCHMICKLE(!note.cache);
+            if (PositionType::none == cache->triplets[index]
+                    && !note.isSelectable(state.selectedChannels)) {
                 continue;
             }
             
@@ -658,7 +657,7 @@ void CacheBuilder::setDurations() {
         uint8_t pitchPosition = NOTE_ON == note.type ? pitchMap[note.pitch()].position : 0;
         int quantDuration = NoteCache::Quantize(note.duration);
         // if note is 2/3rds of a regular duration, it may be part of a third; defer tie in case
-        int notesTied = bar.notesTied(notes->notes[index].triplet, quantStart, quantDuration, ppq);
+        int notesTied = bar.notesTied(cache->triplets[index], quantStart, quantDuration, ppq);
         if (1 == notesTied) {
             cacheEntry.vDuration = quantDuration;
 #if DEBUG_DURATIONS
@@ -682,7 +681,7 @@ void CacheBuilder::setDurations() {
             bool accidentalSpace = NOTE_ON == note.type;
             cache->notes.pop_back();
             do {
-                bool twoThirds = PositionType::none != notes->notes[index].triplet;
+                bool twoThirds = PositionType::none != cache->triplets[index];
                 do {
                     cache->notes.emplace_back(&note);
                     NoteCache& tiePart = cache->notes.back();
@@ -732,11 +731,12 @@ void CacheBuilder::setDurations() {
     cache->notes.shrink_to_fit();
     // sort, shrink, vector push back may move cache locations, so set them up last
     // walk backwards to put point note at first cache entry if note has more than one
+    cache->byNote.assign(notes->notes.size(), nullptr);
     for (auto riter = cache->notes.rbegin(); riter != cache->notes.rend(); ++riter) {
-        const_cast<DisplayNote*>(riter->note)->cache = &*riter;
+        cache->byNote[riter->note - &notes->notes.front()] = &*riter;
     }
     // check to see if things moved
-    SCHMICKLE(notes->notes.front().cache == &cache->notes.front());
+    SCHMICKLE(cache->byNote.front() == &cache->notes.front());
     SCHMICKLE(cache->notes.front().note == &notes->notes.front());
 #if DEBUG_DURATIONS
     if (debugVerbose) DEBUG("finished set durations");
@@ -786,6 +786,8 @@ void CacheBuilder::updateXPosition() {
     bool testForTriplets = third * 3 == ppq && !(third & (third - 1));  // check if only top bit set
     if (testForTriplets) {
         notes->findTriplets(cache);
+    } else {
+        cache->triplets.assign(notes->notes.size(), PositionType::none);
     }
     cache->notes.clear();
     cache->notes.reserve(notes->notes.size());  // just a guess
@@ -795,7 +797,7 @@ void CacheBuilder::updateXPosition() {
     //       : Next, figure out how many horizontal positions are required to show non-overlapping
     //         notes.
     this->cacheStaff();  // set staff flag if note owns shared staff
-    SCHMICKLE(notes->notes.front().cache == &cache->notes.front());
+    SCHMICKLE(cache->byNote.front() == &cache->notes.front());
     SCHMICKLE(cache->notes.front().note == &notes->notes.front());
     if (testForTriplets) {  
         this->cacheTuplets();
@@ -941,6 +943,6 @@ void CacheBuilder::updateXPosition() {
 #endif
         beam.set(cache->notes);
     }
-    SCHMICKLE(notes->notes.front().cache == &cache->notes.front());
+    SCHMICKLE(cache->byNote.front() == &cache->notes.front());
     SCHMICKLE(cache->notes.front().note == &notes->notes.front());
 }
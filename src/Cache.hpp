@@ -39,6 +39,9 @@ struct BeamPosition {
 struct DisplayCache {
     vector<NoteCache> notes;  // where note is drawn (computed cache, not saved)
     vector<BeamPosition> beams; // where beams/ties/slurs/triplets are drawn
+    // indexed by note; kept here rather than in notes, since notes may be shared by other slots
+    vector<const NoteCache*> byNote;    // first entry drawing note; null if note is not drawn
+    vector<PositionType> triplets;      // where note falls in a triplet, if it does
     bool leadingTempo = false;
 
 #if DEBUG_STD
@@ -135,10 +138,10 @@ struct PosAdjust {
 
 struct CacheBuilder {
     const DisplayState& state;
-    Notes* notes;
+    const Notes* notes;
     DisplayCache* cache;
     
-    CacheBuilder(const DisplayState& , Notes* , DisplayCache* );
+    CacheBuilder(const DisplayState& , const Notes* , DisplayCache* );
 
     void cacheBeams();
     void cacheSlurs();
@@ -16,6 +16,17 @@ struct NoteTakerChannel {
         sustainMax,
     };
 
+    enum class Allocate : uint8_t {  // free voice chosen for new note
+        lowestFree,     // lowest numbered voice not playing
+        roundRobin,     // next voice not playing after the one last chosen
+        samePitch,      // voice that last played this pitch, if free; else lowest free
+    };
+
+    enum class Steal : uint8_t {  // voice taken when new note overlaps all voices
+        oldest,         // note that started first
+        quietest,       // note with smallest velocity; oldest if tied
+    };
+
     std::string sequenceName;
     std::string instrumentName;
     int gmInstrument = -1;
@@ -23,6 +34,8 @@ struct NoteTakerChannel {
     int releaseMin = 1;  // midi time for smallest interval gate goes low
     int sustainMin = 1;  // midi time for smallest interval gate goes high
     int sustainMax = 24;
+    Allocate allocate = Allocate::lowestFree;
+    Steal steal = Steal::oldest;
 
     std::string debugString() const;
 
@@ -61,7 +74,8 @@ struct NoteTakerChannel {
     bool isDefault() const {
         return sequenceName.empty() && instrumentName.empty() && !gmInstrument
                 && isDefault(Limit::releaseMax) && isDefault(Limit::releaseMin)
-                && isDefault(Limit::sustainMin) && isDefault(Limit::sustainMax);
+                && isDefault(Limit::sustainMin) && isDefault(Limit::sustainMax)
+                && Allocate::lowestFree == allocate && Steal::oldest == steal;
     }
 
     bool isDefault(Limit limit) const {
@@ -77,6 +91,8 @@ struct NoteTakerChannel {
         releaseMin = DefaultLimit(Limit::releaseMin);
         sustainMin = DefaultLimit(Limit::sustainMin);
         sustainMax = DefaultLimit(Limit::sustainMax);
+        allocate = Allocate::lowestFree;
+        steal = Steal::oldest;
     }
 
     void setLimit(Limit limit, int duration) {
@@ -147,6 +163,12 @@ struct NoteTakerChannel {
         if (DefaultLimit(Limit::sustainMax) != sustainMax) {
             json_object_set_new(root, "sustainMax", json_integer(sustainMax));
         }
+        if (Allocate::lowestFree != allocate) {
+            json_object_set_new(root, "allocate", json_integer((int) allocate));
+        }
+        if (Steal::oldest != steal) {
+            json_object_set_new(root, "steal", json_integer((int) steal));
+        }
         return root;
     }
 
@@ -158,6 +180,11 @@ struct NoteTakerChannel {
         INT_FROM_JSON(releaseMin);
         INT_FROM_JSON(sustainMin);
         INT_FROM_JSON(sustainMax);
+        unsigned allocateValue = json_integer_value(json_object_get(root, "allocate"));
+        allocate = allocateValue <= (unsigned) Allocate::samePitch ? (Allocate) allocateValue
+                : Allocate::lowestFree;
+        unsigned stealValue = json_integer_value(json_object_get(root, "steal"));
+        steal = stealValue <= (unsigned) Steal::quietest ? (Steal) stealValue : Steal::oldest;
     }
 };
 
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "SchmickleWorks.hpp"
+
+// follows an external clock: filters the time between edges to estimate the clock period,
+// and at each edge picks a tick rate that brings play to the next edge's tick just as the
+// next edge is predicted to arrive, so play stays phase locked instead of lagging a beat
+// play never passes the tick of the next edge before that edge arrives; if the clock stops,
+// play waits there, and resumes locked when the clock restarts
+struct ClockFollower {
+    enum class Smoothing : uint8_t {  // order matches UI
+        none,       // period is last interval between edges
+        light,
+        medium,
+        heavy,      // period follows slowly; best for swung or jittery clocks
+    };
+
+    // settings saved with the module
+    unsigned ppqn = 1;              // clock edges per quarter note
+    Smoothing smoothing = Smoothing::medium;
+    // follower state (not saved)
+    double lastEdge = -1;           // real seconds of last edge; negative if phase isn't locked
+    double period = 0;              // filtered seconds between edges; zero until learned
+    double edgeTicks = 0;           // midi time play should reach at last edge
+    double ticksPerPulse = 0;
+    double tickRate = 0;            // midi ticks per second until next edge; zero if unknown
+    bool reacquire = false;         // last interval was a dropout; trust the next one as is
+
+    static bool ValidPpqn(unsigned value) {
+        return 1 == value || 4 == value || 24 == value || 48 == value;
+    }
+
+    // weight of newest interval in period estimate
+    double weight() const {
+        switch (smoothing) {
+            case Smoothing::none: return 1;
+            case Smoothing::light: return 0.5;
+            case Smoothing::medium: return 0.25;
+            case Smoothing::heavy: return 0.1;
+            default:
+                _schmickled();
+        }
+        return 1;
+    }
+
+    // midi time play may not pass until another edge arrives
+    double limit() const {
+        return lastEdge < 0 ? DBL_MAX : edgeTicks + ticksPerPulse;
+    }
+
+    // unlocks phase, keeping the learned period; next edge locks to play position then
+    void restart() {
+        lastEdge = -1;
+        reacquire = false;
+    }
+
+    // keeps phase locked when play jumps back by ticks, as when the next slot starts
+    void rebase(double ticks) {
+        if (lastEdge >= 0) {
+            edgeTicks -= ticks;
+        }
+    }
+
+    // forgets period as well; call when clock is disconnected
+    void reset() {
+        this->restart();
+        period = 0;
+        tickRate = 0;
+    }
+
+    // call on rising edge at real time now, while play is at midi time position
+    void edge(double now, double position, int ppq) {
+        ticksPerPulse = (double) ppq / ppqn;
+        if (lastEdge < 0) {
+            lastEdge = now;
+            edgeTicks = position;
+            tickRate = period ? ticksPerPulse / period : 0;
+            return;
+        }
+        double interval = now - lastEdge;
+        lastEdge = now;
+        edgeTicks += ticksPerPulse;
+        // an interval much longer than expected means the clock stopped; play waited at
+        // this edge's tick, so keep the period learned before the dropout
+        if (period && interval > period * 4 && !reacquire) {
+            reacquire = true;
+        } else {
+            period = !period || reacquire ? interval : period + this->weight() * (interval - period);
+            reacquire = false;
+        }
+        if (period <= 0) {
+            tickRate = 0;
+            return;
+        }
+        // correct phase error by the next edge, within half to twice the clock's tempo
+        double nominal = ticksPerPulse / period;
+        double ahead = edgeTicks + ticksPerPulse - position;
+        tickRate = std::max(nominal / 2, std::min(nominal * 2, ahead / period));
+    }
+
+    std::string debugString() const;
+};
@@ -57,7 +57,11 @@ constexpr unsigned VOICE_COUNT = 16;
 
 constexpr float DEFAULT_GATE_HIGH_VOLTAGE = 10;
 constexpr unsigned CV_OUTPUTS = 4;
-constexpr unsigned EXPANSION_OUTPUTS = 8;
+// each chained super 8 adds cv and gate outputs for four channels; the first two also add
+// velocity outputs for eight channels each
+constexpr unsigned SUPER8_CV_OUTPUTS = 4;
+constexpr unsigned SUPER8_VELOCITY_OUTPUTS = 8;
+constexpr unsigned SUPER8_CHAIN_MAX = (CHANNEL_COUNT - CV_OUTPUTS) / SUPER8_CV_OUTPUTS;
 
 struct NoteDurations {
     static int Beams(unsigned index);
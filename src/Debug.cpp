@@ -134,9 +134,6 @@ std::string DisplayNote::debugString() const {
         s += "/" + std::to_string(voice);
     }
     s += "] " + std::to_string(duration);
-    if (PositionType::none != triplet) {
-        s += " 3" + PosAsStr(triplet);
-    }
     switch (type) {
         case NOTE_ON:
             s += " pitch=" + std::to_string(this->pitch());
@@ -194,8 +191,8 @@ std::string DisplayNote::debugString(const vector<DisplayNote>& notes,
         cacheDump = " " + entry->debugString();
         if (last) {
             SCHMICKLE(&noteCache->front() <= last && last <= &noteCache->back());
-            SCHMICKLE(last < cache);
-            while (++last < cache) {
+            SCHMICKLE(last < entry);
+            while (++last < entry) {
                 result += std::to_string(last - &noteCache->front()) + "/"
                         + std::to_string(this - &notes.front()) + " "
                         + last->debugString() + "\n                              ";
@@ -280,8 +277,18 @@ void Notes::DebugDump(const vector<DisplayNote>& notes, unsigned start, unsigned
     unsigned size = notes.size();
     start = std::min(start, size - std::min(size, 20U));  // show at least 20 notes
     end = std::min(size, std::max(start + 20, end));
-    if (notes.size()) DEBUG("%s notes.front().cache %p &notes.front() %p", __func__,
-            notes.front().cache, &notes.front());
+    // first cache entry drawing each note, as the display cache's byNote has it
+    vector<const NoteCache*> byNote(notes.size(), nullptr);
+    if (cache) {
+        for (auto riter = cache->rbegin(); riter != cache->rend(); ++riter) {
+            size_t index = riter->note - &notes.front();
+            if (index < byNote.size()) {
+                byNote[index] = &*riter;
+            }
+        }
+    }
+    if (notes.size()) DEBUG("%s byNote.front() %p &notes.front() %p", __func__,
+            byNote.front(), &notes.front());
     if (cache) DEBUG("&cache->front() %p cache->front().note %p", &cache->front(),
             cache->front().note);
     // to do : move this to some static assert or one time initialization function
@@ -294,12 +301,13 @@ void Notes::DebugDump(const vector<DisplayNote>& notes, unsigned start, unsigned
         const DisplayNote& note = notes[index];
         std::string angleStart = INT_MAX != selectStart && &note == &notes[selectStart] ? "< " : "";
         std::string angleEnd = INT_MAX != selectEnd && &note == &notes[selectEnd - 1] ? " >" : "";
-        DEBUG("%s", note.debugString(notes, cache, note.cache, last, angleStart, angleEnd).c_str());
-        last = note.cache;
+        DEBUG("%s", note.debugString(notes, cache, byNote[index], last, angleStart,
+                angleEnd).c_str());
+        last = byNote[index];
     }
 }
 
-void NoteTakerParseMidi::DebugDumpRawMidi(const vector<uint8_t>& v) {
+void NoteTakerParseMidi::DebugDumpRawMidi(MidiSpan v) {
     std::string s;
     unsigned line = v.size();
     for (unsigned i = 0; i < v.size(); ++i) {
@@ -468,5 +476,64 @@ std::string NoteTakerChannel::debugString() const {
     s += " relMin " + std::to_string(releaseMin);
     s += " susMin " + std::to_string(sustainMin);
     s += " susMax " + std::to_string(sustainMax);
+    s += " alloc " + std::to_string((int) allocate);
+    s += " steal " + std::to_string((int) steal);
     return s.substr(1);
 }
+
+std::string PlayTimeline::debugString(unsigned index) const {
+    static const char* playTypeNames[] = { "header", "gate off", "gate on", "tempo",
+            "key signature", "time signature", "track end" };
+    SCHMICKLE(index < this->size());
+    std::string s = "[" + std::to_string(index) + "] " + playTypeNames[(int) types[index]]
+            + " time " + std::to_string(times[index]);
+    if (PlayType::gateOn == types[index] || PlayType::gateOff == types[index]) {
+        s += " chan " + std::to_string(channels[index]) + " voice " + std::to_string(voices[index]);
+    }
+    if (PlayType::gateOn == types[index]) {
+        s += " end " + std::to_string(ends[index]) + " cv " + TrimmedFloat(cvs[index])
+                + " vel " + TrimmedFloat(velocities[index]);
+    } else if (data[index]) {
+        s += " data " + std::to_string(data[index]);
+    }
+    return s + " note " + std::to_string(noteIndex[index]);
+}
+
+std::string Voices::debugString(unsigned voice, const PlayTimeline& timeline) const {
+    unsigned event = voices[voice].event;
+    if (INT_MAX == event) {
+        return "(idle)";
+    }
+    return timeline.debugString(event) + " realStart " + std::to_string(voices[voice].realStart)
+            + " cv " + TrimmedFloat(cvs[voice]) + " gate " + TrimmedFloat(gates[voice])
+            + " velocity " + TrimmedFloat(velocities[voice]);
+}
+
+std::string RenderStats::debugString() const {
+    std::string s;
+    s += "samples " + std::to_string(samples);
+    s += " events " + std::to_string(events);
+    s += " ns/sample " + TrimmedFloat(samples ? totalTime * 1e9 / samples : 0);
+    if (worstTime) {
+        s += " worst sample ns " + TrimmedFloat(worstTime * 1e9);
+    }
+    s += " events/sec " + TrimmedFloat(renderedTime ? events / renderedTime : 0);
+    s += " faster than real time x" + TrimmedFloat(totalTime ? renderedTime / totalTime : 0);
+    return s;
+}
+
+std::string ClockFollower::debugString() const {
+    std::string s;
+    s += "ppqn " + std::to_string(ppqn);
+    s += " smoothing " + std::to_string((int) smoothing);
+    s += " period " + TrimmedFloat(period);
+    s += " edgeTicks " + TrimmedFloat(edgeTicks);
+    s += " tickRate " + TrimmedFloat(tickRate);
+    if (lastEdge < 0) {
+        s += " unlocked";
+    }
+    if (reacquire) {
+        s += " reacquire";
+    }
+    return s;
+}
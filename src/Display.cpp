@@ -475,8 +475,8 @@ void DisplayRange::setRange(const Notes& n) {
 // editStart is selectButton->editStart()
 void DisplayRange::updateRange(const Notes& n, const DisplayCache* cache, bool editStart) {
     const vector<NoteCache>& notes = cache->notes;
-    int selectStartXPos = n.xPosAtStartStart();
-    int selectEndXPos = n.xPosAtEndEnd(state);
+    int selectStartXPos = n.xPosAtStartStart(*cache);
+    int selectEndXPos = n.xPosAtEndEnd(*cache, state);
     int selectWidth = selectEndXPos - selectStartXPos;
     int boxWidth = (int) std::ceil(bw);
     int displayEndXPos = (int) (std::ceil(xAxisOffset + bw));
@@ -503,9 +503,9 @@ void DisplayRange::updateRange(const Notes& n, const DisplayCache* cache, bool e
         // compute xAxisOffset first; then use that and boxWidth to figure displayStart, displayEnd
         float oldX = xAxisOffset;
         if (n.selectEnd != oldEnd && n.selectStart == oldStart) { // only end moved
-            const NoteCache* last = n.lastCache(n.selectEnd);
+            const NoteCache* last = n.lastCache(*cache, n.selectEnd);
             xAxisOffset = (NoteTakerDisplay::CacheWidth(*last, state.vg) > boxWidth ?
-                n.xPosAtEndStart() :  // show beginning of end
+                n.xPosAtEndStart(*cache) :  // show beginning of end
                 selectEndXPos - boxWidth) + displayEndMargin;  // show all of end
 #if DEBUG_DISPLAY_RANGE
             if (debugVerbose) DEBUG("1 xAxisOffset %g", xAxisOffset);
@@ -516,7 +516,7 @@ void DisplayRange::updateRange(const Notes& n, const DisplayCache* cache, bool e
             if (debugVerbose) DEBUG("2 xAxisOffset %g", xAxisOffset);
 #endif
         } else {    // scroll enough to show start on right
-            int selectBoxX = n.xPosAtStartEnd();
+            int selectBoxX = n.xPosAtStartEnd(*cache);
             xAxisOffset = selectBoxX - boxWidth + displayEndMargin;
 #if DEBUG_DISPLAY_RANGE
             if (debugVerbose) DEBUG("3 xAxisOffset %g selectBoxX %d", xAxisOffset, selectBoxX);
@@ -682,22 +682,22 @@ void NoteTakerDisplay::draw(const DrawArgs& args) {
     if (false && debugVerbose) {    // to do : why does this ping pong between two sets, sometimes?
         static const DisplayNote* lastNotes = nullptr;
         static const NoteCache* lastCache = nullptr;
-        if (lastCache != n->notes.front().cache || lastNotes != cache->notes.front().note) {
+        if (lastCache != cache->byNote.front() || lastNotes != cache->notes.front().note) {
             DEBUG("slot %p notes %p cache %p ", slot, &n->notes.front(), slot->cache.notes.front());
-            DEBUG("%s n->notes.front().cache %p", __func__, n->notes.front().cache);
+            DEBUG("%s cache->byNote.front() %p", __func__, cache->byNote.front());
             DEBUG("&cache->notes.front() %p", &cache->notes.front());
             lastNotes = cache->notes.front().note;
-            lastCache = n->notes.front().cache;
+            lastCache = cache->byNote.front();
         } 
     }
-    SCHMICKLE(n->notes.front().cache == &cache->notes.front());
+    SCHMICKLE(cache->byNote.front() == &cache->notes.front());
     SCHMICKLE(cache->notes.front().note == &n->notes.front());
     if (range.invalid) {
-        if (debugVerbose && n->notes.front().cache != &cache->notes.front()) {
-            DEBUG("n->notes.front().cache %p", n->notes.front().cache);
+        if (debugVerbose && cache->byNote.front() != &cache->notes.front()) {
+            DEBUG("cache->byNote.front() %p", cache->byNote.front());
             DEBUG("&cache->notes.front() %p", &cache->notes.front());
         }
-        SCHMICKLE(n->notes.front().cache == &cache->notes.front());
+        SCHMICKLE(cache->byNote.front() == &cache->notes.front());
         SCHMICKLE(cache->notes.front().note == &n->notes.front());
         range.updateRange(*n, cache, ntw->selectButton->editStart());
         range.invalid = false;
@@ -705,6 +705,10 @@ void NoteTakerDisplay::draw(const DrawArgs& args) {
 #if RUN_UNIT_TEST
     if (ntw->nt() && ntw->runUnitTest) { // to do : remove this from shipping code
         UnitTest(ntw, TestType::encode);
+        UnitTest(ntw, TestType::makeMidi);
+        UnitTest(ntw, TestType::timeline);
+        UnitTest(ntw, TestType::mergeTracks);
+        UnitTest(ntw, TestType::shareNotes);
         ntw->runUnitTest = false;
         this->redraw();
         return;
@@ -741,6 +745,8 @@ void NoteTakerDisplay::draw(const DrawArgs& args) {
     this->recenterVerticalWheel();
     if (ntw->fileButton->ledOn()) {
         this->drawFileControl();
+    } else if (ntw->midiImport.busy()) {
+        this->drawImportProgress();
     }
     if (ntw->partButton->ledOn()) {
         this->drawPartControl();
@@ -761,6 +767,38 @@ void NoteTakerDisplay::draw(const DrawArgs& args) {
     Widget::draw(args);
 }
 
+// steps the display may wait for an idle frame before laying out the next slot anyway
+const unsigned PREPARE_WAIT_STEPS = 30;
+
+// lays out the slot that plays after the current one while the current one plays, so that
+// showing it when the audio thread stages it doesn't stall that frame; its timeline is
+// already compiled
+// called by widget step rather than draw; waits for a step whose frame doesn't redraw the
+// display, so the layout lands on a frame with little else to do, or lays out after a short
+// wait if the display redraws every frame, as it does while scrolling
+// layout measures note glyphs with the draw context, and writes the slot's display cache,
+// which the ui thread reads; so it stays on the ui thread rather than a worker
+void NoteTakerDisplay::prepareNextSlot(bool idle) {
+    auto& storage = this->ntw()->storage;
+    unsigned next = storage.slotStart + 1 < storage.playback.size() ?
+            storage.playback[storage.slotStart + 1].index : 0;
+    if (!state.vg || next >= storage.size()) {
+        return;
+    }
+    NoteTakerSlot& nextSlot = storage.slots[next];
+    if (&nextSlot == slot || !nextSlot.invalid) {
+        prepareWait = 0;
+        return;
+    }
+    if (!idle && ++prepareWait < PREPARE_WAIT_STEPS) {
+        return;
+    }
+    prepareWait = 0;
+    CacheBuilder builder(state, &nextSlot.n, &nextSlot.cache);
+    builder.updateXPosition();
+    nextSlot.invalid = false;
+}
+
 void NoteTakerDisplay::drawArc(const BeamPosition& bp, unsigned start, unsigned index) const {
     auto& notes = this->cache()->notes;
     float yOff = bp.slurOffset;
@@ -1128,9 +1166,10 @@ void NoteTakerDisplay::drawSelectionRect() {
     // draw selection rect
     auto ntw = this->ntw();
     const auto& n = *this->notes();
+    const auto& byNote = this->cache()->byNote;
     unsigned start = n.selectEndPos(n.selectStart);
     const NoteCache* noteCache;
-    while (!(noteCache = n.notes[start].cache) && start < n.notes.size() - 1) {
+    while (!(noteCache = byNote[start]) && start < n.notes.size() - 1) {
         ++start;
     }
     SCHMICKLE(noteCache);
@@ -1167,7 +1206,7 @@ void NoteTakerDisplay::drawSelectionRect() {
                 ;
         }
     } else if (ntw->edit.voice) {
-        auto& startCache = n.notes[n.selectStart].cache;
+        auto startCache = byNote[n.selectStart];
         yTop = startCache->yPosition - 6;
         yHeight = 6;
     } 
@@ -1177,11 +1216,11 @@ void NoteTakerDisplay::drawSelectionRect() {
         // to do : replace this with scissor to prevent drawing into display ui area
     }
     if (!selectButton->editStart() && n.selectEnd > 0) {
-        auto startCache = n.notes[n.selectStart].cache;
+        auto startCache = byNote[n.selectStart];
         xStart = startCache->xPosition - (startCache->accidentalSpace ? 8 : 0);
         unsigned selEndPos = n.selectEndPos(n.selectEnd - 1);
         const NoteCache* endCache;
-        while (!(endCache = n.notes[selEndPos].cache) && selEndPos < n.notes.size()) {
+        while (!(endCache = byNote[selEndPos]) && selEndPos < n.notes.size()) {
             ++selEndPos;
         }
         SCHMICKLE(endCache);
@@ -1254,7 +1293,6 @@ void NoteTakerDisplay::drawDynamicPitchTempo() {
         DisplayNote note(NOTE_ON);
         note.duration = n.ppq;
         NoteCache noteCache(&note);
-        note.cache = &noteCache;
         note.setPitchData((int) ntw->verticalWheel->getValue());    // pitch : to do, add setter ?
         nvgBeginPath(vg);
         nvgRect(vg, box.size.x - 10, 2, 10, box.size.y - 4);
@@ -1293,12 +1331,28 @@ void NoteTakerDisplay::drawFileControl() {
     control.drawEnd();
     control.drawActive(slot, slot + 1);
     SCHMICKLE((unsigned) slot < ntw->storage.size());
+    if (ntw->midiImport.busy() && (unsigned) slot == ntw->midiImport.slot) {
+        this->drawImportProgress();
+        return;
+    }
     const std::string& name = ntw->storage.slots[slot].filename;
     if (!name.empty()) {
         this->drawName(name);
     }
 }
 
+// name of file loading in the background, with a bar along the bottom as it is read
+void NoteTakerDisplay::drawImportProgress() const {
+    const MidiImport& import = ntw()->midiImport;
+    float fraction = import.progress.fraction();
+    this->drawName(import.filename + " " + std::to_string((int) (fraction * 100)) + "%");
+    auto vg = state.vg;
+    nvgBeginPath(vg);
+    nvgRect(vg, 0, box.size.y - 2, box.size.x * fraction, 2);
+    nvgFillColor(vg, nvgRGBA(0, 0, 0, 0x7F));
+    nvgFill(vg);
+}
+
 void NoteTakerDisplay::drawName(std::string name) const {
     float bounds[4];
     auto vg = state.vg;
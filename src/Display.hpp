@@ -158,6 +158,7 @@ struct NoteTakerDisplay : Widget {
     float dynamicCNaturalTimer = 0;
     float dynamicTempoTimer = 0;
     float xControlOffset = 0;
+    unsigned prepareWait = 0;       // steps next slot has waited to be laid out
     float yControlOffset = 0;
     int keySignature = 0;
     int lastTranspose = 60;
@@ -186,6 +187,7 @@ struct NoteTakerDisplay : Widget {
     void drawFileControl();
     void drawFreeNote(const DisplayNote& note, NoteCache* noteCache, int xPos,
             unsigned char alpha);
+    void drawImportProgress() const;
     void drawKeySignature(unsigned index);
     void drawName(std::string ) const;
     void drawNote(Accidental , const NoteCache&, unsigned char alpha, int size) const;
@@ -212,6 +214,7 @@ struct NoteTakerDisplay : Widget {
     }
 
     Notes* notes();
+    void prepareNextSlot(bool idle);
 
     NoteTakerWidget* ntw() {
          return mainWidget;
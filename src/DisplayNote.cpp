@@ -129,7 +129,6 @@ json_t* DisplayNote::dataToJson() const {
 }
 
 void DisplayNote::dataFromJson(json_t* root) {
-    cache = nullptr;
     INT_FROM_JSON(startTime);
     INT_FROM_JSON(duration);
     json_t* noteData = json_object_get(root, "data");
@@ -46,13 +46,11 @@ enum class PositionType : uint8_t {
 // starts, given just the note, is onerous. For now, have validation ensure that
 // there are no gaps and call it often enough to keep the note array sane.
 struct DisplayNote {
-    NoteCache* cache = nullptr;
     int startTime;          // MIDI time (e.g. stdTimePerQuarterNote: 1/4 note == 96)
     int duration;           // MIDI time
     int data[4] = { 0, 0, 0, 0}; // type-specific values / to do : make unsigned, can't serialize <0
     uint8_t channel;        // set to 0 if type doesn't have channel
     uint8_t voice = -1;     // poly voice assigned to note
-    PositionType triplet = PositionType::none;   // cache data conveniently stored here
     DisplayType type;
 
     DisplayNote(DisplayType t, int start = 0, int dur = 0, uint8_t chan = 0)
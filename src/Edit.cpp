@@ -362,9 +362,17 @@ void NoteTakerWidget::updateHorizontal() {
         return;
     }
     bool selectOne = !selectButton->ledOn() && n.selectStart + 1 == n.selectEnd;
-    DisplayNote& oneNote = n.notes[n.selectStart];
+    const DisplayNote& oneNote = n.notes[n.selectStart];
     if (selectOne && MIDI_TEMPO == oneNote.type) {
-        oneNote.setTempo(this->nt()->wheelToTempo(horizontalWheel->getValue()) * 500000);
+        // called every frame; edit notes only when tempo changes, so shared notes stay shared
+        int tempo = this->nt()->wheelToTempo(horizontalWheel->getValue()) * 500000;
+        if (tempo != oneNote.tempo()) {
+            const DisplayNote* unedited = &n.notes.front();
+            n.notes.edit()[n.selectStart].setTempo(tempo);
+            if (unedited != &n.notes.front()) {
+                display->invalidateCache();  // cache points into notes that edit copied
+            }
+        }
         displayBuffer->redraw();
         return;
     }
@@ -373,16 +381,17 @@ void NoteTakerWidget::updateHorizontal() {
     }
     const int wheelValue = horizontalWheel->wheelValue();
     if (selectOne && TIME_SIGNATURE == oneNote.type) {
+        DisplayNote& timeSignature = n.notes.edit()[n.selectStart];
         if ((int) verticalWheel->getValue()) {
-            oneNote.setNumerator(wheelValue);
+            timeSignature.setNumerator(wheelValue);
         } else {
-            oneNote.setDenominator(wheelValue);
+            timeSignature.setDenominator(wheelValue);
         }
         this->invalAndPlay(Inval::change);
         return;
     }
     if (selectOne && KEY_SIGNATURE == oneNote.type) {
-        oneNote.setMinor(wheelValue);
+        n.notes.edit()[n.selectStart].setMinor(wheelValue);
         this->invalAndPlay(Inval::change);
         return;
     }
@@ -403,7 +412,8 @@ void NoteTakerWidget::updateHorizontal() {
         vector<std::pair<int, int>> overlaps; // orig end time, adj end time
         // proportionately adjust start times and durations of all in selection
         // additionally, compute the insertedTime as n.nextStart - selectStart.start mod wheel change
-        auto* note = &n.notes[n.selectStart];
+        auto& notes = n.notes.edit();
+        auto* note = &notes[n.selectStart];
         for (unsigned index = edit.base.selectStart; index < edit.base.selectEnd; ++index) {
             const auto& test = edit.base.notes[index];
             if (test.isSelectable(selectChannels)) {
@@ -448,7 +458,7 @@ void NoteTakerWidget::updateHorizontal() {
                 maxEnd = std::max(maxEnd, note->endTime());
                 // because sorting may change edit base and note order, advance note separately
                 // (each selectable note is still ordered the same as each saved base note, though)
-            } while (++note < &n.notes.back() && !note->isSelectable(selectChannels));
+            } while (++note < &notes.back() && !note->isSelectable(selectChannels));
         }
         overlaps.emplace_back(std::pair<int, int>(edit.selectMaxEnd, selectMaxEnd));
         if (!edit.voice) {
@@ -462,10 +472,10 @@ void NoteTakerWidget::updateHorizontal() {
             // note subtract one skips track end
             const unsigned last = edit.base.notes.size() - 1;
             SCHMICKLE(TRACK_END == edit.base.notes[last].type);
-            SCHMICKLE(TRACK_END == n.notes[last].type);
+            SCHMICKLE(TRACK_END == notes[last].type);
             for (unsigned index = edit.base.selectEnd; index < last; ++index) {
                 const auto& base = edit.base.notes[index];
-                auto* note = &n.notes[index];
+                auto* note = &notes[index];
                 if (base.isSelectable(selectChannels)) {
                     while (overPtr < &overlaps.back()) {
                         auto overTest = overPtr + 1;
@@ -485,8 +495,8 @@ void NoteTakerWidget::updateHorizontal() {
             }
         }
         // make sure track end is adjusted as necessary
-        SCHMICKLE(TRACK_END == n.notes.back().type);
-        n.notes.back().startTime = maxEnd;
+        SCHMICKLE(TRACK_END == notes.back().type);
+        notes.back().startTime = maxEnd;
         inval = Inval::note;
         n.sort();   // to do : don't call this directly; storage function should sort and invalidate
         storage.invalidate();
@@ -677,8 +687,10 @@ void NoteTakerWidget::updateVertical() {
         // transpose selection
         // loop below computes diff of first note, and adds diff to subsequent notes in select
         bool playNotes = false;
+        const DisplayNote* unedited = &n.notes.front();
+        auto& notes = n.notes.edit();
         for (unsigned index = n.selectStart ; index < n.selectEnd; ++index) {
-            DisplayNote& note = n.notes[index];
+            DisplayNote& note = notes[index];
             switch (note.type) {
                 case KEY_SIGNATURE:
                     if (n.selectStart + 1 == n.selectEnd) {
@@ -730,6 +742,8 @@ void NoteTakerWidget::updateVertical() {
         }
         if (playNotes) {
             this->invalAndPlay(Inval::change);
+        } else if (unedited != &notes.front()) {
+            display->invalidateCache();  // cache points into notes that edit copied
         }
         return;
     } else if (selectButton->editEnd()) {
@@ -788,7 +802,7 @@ void NoteTakerWidget::updateVertical() {
             edit.voice = true;
             this->invalAndPlay(Inval::note);
         } else {
-            n.setPitch(&n.notes[n.selectStart], pitch);
+            n.setPitch(&n.notes.edit()[n.selectStart], pitch);
             this->invalAndPlay(Inval::change);
         }
     }
@@ -0,0 +1,56 @@
+#include "Import.hpp"
+
+// called by ui thread; waits for worker to notice, which it does within a few messages
+void MidiImport::cancel() {
+    if (!worker.joinable()) {
+        return;
+    }
+    progress.cancel.store(true, std::memory_order_relaxed);
+    worker.join();
+    state.store(State::idle, std::memory_order_relaxed);
+    staged.n.notes.clear();
+    if (debugVerbose) DEBUG("%s %s%s", __func__, directory.c_str(), filename.c_str());
+}
+
+// called by ui thread each step; true once, when worker has stopped
+bool MidiImport::finished() {
+    if (!worker.joinable() || State::running == state.load(std::memory_order_acquire)) {
+        return false;
+    }
+    worker.join();
+    return true;
+}
+
+void MidiImport::start(unsigned slotIndex, const std::string& dir, const std::string& name) {
+    this->cancel();
+    slot = slotIndex;
+    directory = dir;
+    filename = name;
+    staged.directory = dir;
+    staged.filename = name;
+    progress.reset(0);
+    state.store(State::running, std::memory_order_relaxed);
+    worker = std::thread([this]() {
+        bool loaded = staged.setFromMidi(&progress);
+        state.store(loaded ? State::done : State::failed, std::memory_order_release);
+    });
+}
+
+// moves staged notes into slot; leaves slot unchanged if file could not be read
+bool MidiImport::take(NoteTakerSlot* dest) {
+    bool loaded = State::done == state.load(std::memory_order_acquire);
+    state.store(State::idle, std::memory_order_relaxed);
+    if (!loaded) {
+        DEBUG("%s failed to load %s%s", __func__, directory.c_str(), filename.c_str());
+        staged.n.notes.clear();
+        return false;
+    }
+    dest->n.notes = staged.n.notes;
+    dest->n.notes.share();  // staged on worker thread; share only here, on ui thread
+    dest->n.ppq = staged.n.ppq;
+    dest->directory = directory;
+    dest->filename = filename;
+    dest->invalid = true;
+    staged.n.notes.clear();
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ParseMidi.hpp"
+#include "Storage.hpp"
+#include <atomic>
+#include <thread>
+
+// loads a midi file on a worker thread into a staging slot, so a large file doesn't stall
+// the ui; the ui thread starts it, draws its progress, and takes the staged notes once the
+// worker is done, then rebuilds the slot's timeline, which the audio thread picks up at once
+struct MidiImport {
+    enum class State {
+        idle,
+        running,
+        done,
+        failed,
+    };
+
+    NoteTakerSlot staged;           // written only by worker while running
+    ParseProgress progress;
+    std::thread worker;
+    std::atomic<State> state { State::idle };
+    std::string directory;
+    std::string filename;
+    unsigned slot = 0;              // index of slot file replaces
+
+    ~MidiImport() {
+        this->cancel();
+    }
+
+    bool busy() const {
+        return worker.joinable();
+    }
+
+    void cancel();
+    bool finished();
+    void start(unsigned slotIndex, const std::string& dir, const std::string& name);
+    bool take(NoteTakerSlot* );
+};
@@ -1,11 +1,50 @@
 
 #include "Button.hpp"
 #include "Display.hpp"
+#include "Library.hpp"
 #include "Taker.hpp"
 #include "Storage.hpp"
 #include "Wheel.hpp"
 #include "Widget.hpp"
 
+json_t* ProcessProfile::toJson() const {
+    json_t* root = json_object();
+    for (unsigned index = 0; index < PHASE_COUNT; ++index) {
+        const Histogram& h = phases[index];
+        json_t* phase = json_object();
+        json_t* buckets = json_array();
+        for (const auto& bucket : h.buckets) {
+            json_array_append_new(buckets, json_integer(bucket.load(std::memory_order_relaxed)));
+        }
+        json_object_set_new(phase, "buckets", buckets);
+        json_object_set_new(phase, "worstNs", json_integer(h.worst.load(std::memory_order_relaxed)));
+        json_object_set_new(root, PhaseName((Phase) index), phase);
+    }
+    json_object_set_new(root, "firstBucketNs", json_integer(FIRST_BUCKET_NS));
+    json_object_set_new(root, "idleSamples", json_integer(idleSamples.load(std::memory_order_relaxed)));
+    json_object_set_new(root, "blockPlays", json_integer(blockPlays.load(std::memory_order_relaxed)));
+    json_object_set_new(root, "events", json_integer(events.load(std::memory_order_relaxed)));
+    json_object_set_new(root, "notesStarted",
+            json_integer(notesStarted.load(std::memory_order_relaxed)));
+    json_object_set_new(root, "requestsMax", json_integer(requestsMax.load(std::memory_order_relaxed)));
+    json_object_set_new(root, "notifyMax", json_integer(notifyMax.load(std::memory_order_relaxed)));
+    return root;
+}
+
+bool Clipboard::playBackFromJson(json_t* root) {
+    json_t* slots = json_object_get(root, "slots");
+    if (!json_array_size(slots)) {
+        return false;
+    }
+    playback.resize(json_array_size(slots));
+    size_t index;
+    json_t* value;
+    json_array_foreach(slots, index, value) {
+        playback[index].fromJson(value);
+    }
+    return true;
+}
+
 json_t* Clipboard::playBackToJson() const {
     json_t* root = json_object();
     json_t* slots = json_array();
@@ -24,6 +63,24 @@ void Clipboard::notesToJson(json_t* root) const {
     }
 }
 
+json_t* MidiLibraryEntry::toJson() const {
+    json_t* root = json_object();
+    json_object_set_new(root, "directory", json_string(directory.c_str()));
+    json_object_set_new(root, "filename", json_string(filename.c_str()));
+    json_object_set_new(root, "mtime", json_integer(mtime));
+    json_object_set_new(root, "size", json_integer(size));
+    json_object_set_new(root, "indexed", json_integer(indexed));
+    if (indexed) {
+        json_object_set_new(root, "seconds", json_real(seconds));
+        json_object_set_new(root, "tracks", json_integer(tracks));
+        json_object_set_new(root, "noteCount", json_integer(noteCount));
+        json_object_set_new(root, "channels", json_integer(channels));
+        json_object_set_new(root, "ppq", json_integer(ppq));
+        json_object_set_new(root, "instruments", json_string(instruments.c_str()));
+    }
+    return root;
+}
+
 json_t* Notes::toJson() const {
     json_t* root = json_object();
     if (compressJsonNotes) {
@@ -67,6 +124,10 @@ json_t* NoteTaker::dataToJson() {
     }
     json_object_set_new(root, "voiceCounts", voices);
     json_object_set_new(root, "tempo", json_integer(tempo));
+    json_object_set_new(root, "clockPpqn", json_integer(clockFollower.ppqn));
+    json_object_set_new(root, "clockSmoothing", json_integer((int) clockFollower.smoothing));
+    json_object_set_new(root, "blockSize", json_integer(blockSize));
+    json_object_set_new(root, "storage", storage.toJson());
     return root;
 }
 
@@ -109,12 +170,12 @@ json_t* NoteTakerWidget::toJson() {
     json_object_set_new(root, "verticalWheel", verticalWheel->toJson());
     // end of mostly no-op section
     json_object_set_new(root, "selectChannels", json_integer(selectChannels));
-    json_object_set_new(root, "storage", storage.toJson());
     json_object_set_new(root, "compressJsonNotes", json_integer(compressJsonNotes));
     json_object_set_new(root, "debugCapture", json_integer(debugCapture));
     json_object_set_new(root, "debugVerbose", json_integer(debugVerbose));
     json_object_set_new(root, "groupByGMInstrument", json_integer(groupByGMInstrument));
     json_object_set_new(root, "midiQuantizer", json_integer(midiQuantizer));
+    json_object_set_new(root, "librarySort", json_integer((int) MidiLibrary::Shared().sort));
     return root;
 }
 
@@ -170,13 +231,31 @@ bool Notes::FromJsonUncompressed(json_t* jNotes, vector<DisplayNote>* notes) {
     return (bool) jNotes;
 }
 
+void MidiLibraryEntry::fromJson(json_t* root) {
+    STRING_FROM_JSON(directory);
+    STRING_FROM_JSON(filename);
+    INT_FROM_JSON(mtime);
+    INT_FROM_JSON(size);
+    INT_FROM_JSON(indexed);
+    REAL_FROM_JSON(seconds);
+    INT_FROM_JSON(tracks);
+    INT_FROM_JSON(noteCount);
+    INT_FROM_JSON(channels);
+    INT_FROM_JSON(ppq);
+    STRING_FROM_JSON(instruments);
+}
+
 void Notes::fromJson(json_t* root) {
-    bool uncompressed = FromJsonUncompressed(json_object_get(root, "notesUncompressed"), &notes);
+    vector<DisplayNote> loaded;
+    bool uncompressed = FromJsonUncompressed(json_object_get(root, "notesUncompressed"), &loaded);
     // compressed overrides if both present
-    if (!FromJsonCompressed(json_object_get(root, "notesCompressed"), &notes, &ppq, uncompressed)) {
+    if (!FromJsonCompressed(json_object_get(root, "notesCompressed"), &loaded, &ppq, uncompressed)) {
         Notes empty;
         notes = empty.notes;
+    } else {
+        notes.assign(std::move(loaded));
     }
+    notes.share();  // other slots may have loaded the same score
     SCHMICKLE(notes.size() >= 2);
     INT_FROM_JSON(selectStart);
     if (selectStart + 1 >= notes.size()) {
@@ -200,6 +279,26 @@ void NoteTaker::dataFromJson(json_t* root) {
         outputs[CV1_OUTPUT + index].setChannels(json_integer_value(value));
     }
     INT_FROM_JSON(tempo);
+    unsigned clockPpqn = json_integer_value(json_object_get(root, "clockPpqn"));
+    if (ClockFollower::ValidPpqn(clockPpqn)) {
+        clockFollower.ppqn = clockPpqn;
+    }
+    json_t* clockSmoothing = json_object_get(root, "clockSmoothing");
+    if (clockSmoothing) {
+        clockFollower.smoothing = (ClockFollower::Smoothing) std::min(
+                (unsigned) json_integer_value(clockSmoothing),
+                (unsigned) ClockFollower::Smoothing::heavy);
+    }
+    unsigned savedBlockSize = json_integer_value(json_object_get(root, "blockSize"));
+    if (ValidBlockSize(savedBlockSize)) {
+        blockSize = savedBlockSize;
+    }
+    // older patches saved storage with the widget; it reads it back if present
+    json_t* jStorage = json_object_get(root, "storage");
+    if (jStorage) {
+        storage.fromJson(jStorage);
+    }
+    this->publishStorage();
 }
 
 void NoteTakerSlot::fromJson(json_t* root) {
@@ -216,12 +315,21 @@ void NoteTakerSlot::fromJson(json_t* root) {
 
 void NoteTakerWidget::fromJson(json_t* root) {
     ModuleWidget::fromJson(root);
-    bool clipboardUncompressed = clipboard.fromJsonUncompressed(json_object_get(root,
-            "clipboardUncompressed"));
-    // compressed overrides if both present
-    clipboard.fromJsonCompressed(json_object_get(root, "clipboardCompressed"),
-        clipboardUncompressed);
-    SlotArray::FromJson(root, &clipboard.playback);
+    // clipboard is shared; a saved one fills it only if empty, so loading each note taker in
+    // a patch doesn't replace what another loaded or what was cut or copied since
+    Clipboard saved;
+    if (clipboard.notes.empty()) {
+        bool clipboardUncompressed = saved.fromJsonUncompressed(json_object_get(root,
+                "clipboardUncompressed"));
+        // compressed overrides if both present
+        saved.fromJsonCompressed(json_object_get(root, "clipboardCompressed"),
+            clipboardUncompressed);
+        clipboard.notes = std::move(saved.notes);
+    }
+    if (clipboard.playback.empty()
+            && saved.playBackFromJson(json_object_get(root, "clipboardSlots"))) {
+        clipboard.playback = std::move(saved.playback);
+    }
     // read back controls' state
     edit.fromJson(json_object_get(root, "edit"));
     cutButton->fromJson(json_object_get(root, "cutButton"));
@@ -251,13 +359,20 @@ void NoteTakerWidget::fromJson(json_t* root) {
         }
     }
     INT_FROM_JSON(selectChannels);
-    storage.fromJson(json_object_get(root, "storage"));
+    json_t* jStorage = json_object_get(root, "storage");
+    if (jStorage) {  // saved by older versions; now saved with module
+        storage.fromJson(jStorage);
+        if (this->nt()) {
+            this->nt()->publishStorage();
+        }
+    }
     display->range.fromJson(json_object_get(root, "display"));
     INT_FROM_JSON(compressJsonNotes);
     INT_FROM_JSON(debugCapture);
     INT_FROM_JSON(debugVerbose);
     INT_FROM_JSON(groupByGMInstrument);
     INT_FROM_JSON(midiQuantizer);
+    int_from_json(root, "librarySort", &MidiLibrary::Shared().sort);
     // update display cache
     this->setWheelRange();
     displayBuffer->redraw();
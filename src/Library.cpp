@@ -0,0 +1,247 @@
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unordered_map>
+#include "Display.hpp"
+#include "Library.hpp"
+#include "ParseMidi.hpp"
+#include "Storage.hpp"
+
+// files indexed between updates to the menu's copy of the index
+const unsigned LIBRARY_PUBLISH_INTERVAL = 256;
+
+vector<std::string> MidiLibrary::Directories() {
+    return { asset::user("/"), SlotArray::UserDirectory() };
+}
+
+std::string MidiLibrary::IndexPath() {
+    return SlotArray::UserDirectory() + "library.json";
+}
+
+// matches dot mid and dot midi, case insensitive
+bool MidiLibrary::IsMidiName(const std::string& str) {
+    if (str.size() < 5) {
+        return false;
+    }
+    const char* last = &str.back();
+    if ('i' == tolower(*last)) {
+        --last;
+    }
+    const char dotMid[] = ".mid";
+    const char* test = last - 3;
+    for (int index = 0; index < 3; ++index) {
+        if (dotMid[index] != tolower(test[index])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// parses file to fill in what the menu shows; called by worker thread
+void MidiLibrary::Index(MidiLibraryEntry* entry) {
+    NoteTakerSlot slot;
+    slot.directory = entry->directory;
+    slot.filename = entry->filename;
+    array<NoteTakerChannel, CHANNEL_COUNT> channelInfo;
+    // quiet, since a library of thousands of files would flood the log
+    entry->indexed = slot.setFromMidi(nullptr, &channelInfo, true);
+    if (!entry->indexed) {
+        return;
+    }
+    const auto& notes = slot.n.notes;
+    entry->ppq = slot.n.ppq;
+    entry->tracks = MIDI_HEADER == notes.front().type ? notes.front().tracks() : 0;
+    entry->noteCount = 0;
+    entry->channels = 0;
+    double seconds = 0;
+    int tempoTime = 0;
+    int usecs = stdMSecsPerQuarterNote;
+    for (const auto& note : notes) {
+        if (NOTE_ON == note.type) {
+            ++entry->noteCount;
+            entry->channels |= 1 << note.channel;
+        } else if (MIDI_TEMPO == note.type) {
+            seconds += (double) (note.startTime - tempoTime) * usecs / (entry->ppq * 1000000.);
+            tempoTime = note.startTime;
+            usecs = note.tempo();
+        }
+    }
+    int endTime = notes.back().startTime;
+    entry->seconds = seconds + (double) (endTime - tempoTime) * usecs / (entry->ppq * 1000000.);
+    vector<std::string> names;
+    for (const auto& channel : channelInfo) {
+        std::string name = !channel.instrumentName.empty() ? channel.instrumentName :
+                channel.gmInstrument >= 0 ?
+                NoteTakerDisplay::GMInstrumentName(channel.gmInstrument) : channel.sequenceName;
+        if (!name.empty() && names.end() == std::find(names.begin(), names.end(), name)) {
+            names.push_back(name);
+        }
+    }
+    entry->instruments.clear();
+    for (const auto& name : names) {
+        entry->instruments += (entry->instruments.empty() ? "" : ", ") + name;
+    }
+}
+
+// called by ui thread the first time the library is used
+void MidiLibrary::load() {
+    loaded = true;
+    Entries entries;
+    json_error_t error;
+    json_t* root = json_load_file(IndexPath().c_str(), 0, &error);
+    if (root) {
+        json_t* files = json_object_get(root, "files");
+        size_t index;
+        json_t* value;
+        json_array_foreach(files, index, value) {
+            entries.emplace_back();
+            entries.back().fromJson(value);
+        }
+        json_decref(root);
+    }
+    if (debugVerbose) DEBUG("%s %u files", __func__, (unsigned) entries.size());
+    this->publish(entries);
+}
+
+void MidiLibrary::publish(const Entries& entries) {
+    std::atomic_store(&published, std::shared_ptr<const Entries>(std::make_shared<Entries>(entries)));
+}
+
+// called by ui thread whenever the load menu opens; menu shows index as it was, and
+// shows files found by this refresh when next opened
+void MidiLibrary::refresh() {
+    if (!loaded) {
+        this->load();
+    }
+    if (refreshing.load()) {
+        return;
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+    refreshing.store(true);
+    worker = std::thread(&MidiLibrary::update, this, this->entries());
+}
+
+void MidiLibrary::save(const Entries& entries) const {
+    std::string userDir = SlotArray::UserDirectory();
+    if (!system::isDirectory(userDir)) {
+        system::createDirectory(userDir);
+    }
+    json_t* root = json_object();
+    json_t* files = json_array();
+    for (const auto& entry : entries) {
+        json_array_append_new(files, entry.toJson());
+    }
+    json_object_set_new(root, "files", files);
+    if (json_dump_file(root, IndexPath().c_str(), JSON_COMPACT)) {
+        DEBUG("%s could not write %s", __func__, IndexPath().c_str());
+    }
+    json_decref(root);
+}
+
+vector<const MidiLibraryEntry*> MidiLibrary::sorted(const Entries& entries) const {
+    vector<const MidiLibraryEntry*> result;
+    result.reserve(entries.size());
+    for (const auto& entry : entries) {
+        result.push_back(&entry);
+    }
+    auto byName = [](const MidiLibraryEntry* a, const MidiLibraryEntry* b) {
+        return a->filename < b->filename;
+    };
+    switch (sort) {
+        case Sort::name:
+            std::stable_sort(result.begin(), result.end(), byName);
+            break;
+        case Sort::newest:
+            std::stable_sort(result.begin(), result.end(),
+                    [](const MidiLibraryEntry* a, const MidiLibraryEntry* b) {
+                return a->mtime > b->mtime;
+            });
+            break;
+        case Sort::longest:
+            std::stable_sort(result.begin(), result.end(),
+                    [](const MidiLibraryEntry* a, const MidiLibraryEntry* b) {
+                return a->seconds > b->seconds;
+            });
+            break;
+        case Sort::mostNotes:
+            std::stable_sort(result.begin(), result.end(),
+                    [](const MidiLibraryEntry* a, const MidiLibraryEntry* b) {
+                return a->noteCount > b->noteCount;
+            });
+            break;
+        default:
+            _schmickled();
+    }
+    return result;
+}
+
+// called by worker thread; keeps indexed entries whose file time and size are unchanged, and
+// parses the rest, so a refresh after the first reads only new and changed files, and files
+// not yet indexed because the last refresh stopped early or failed to parse them
+void MidiLibrary::update(std::shared_ptr<const Entries> previous) {
+    std::unordered_map<std::string, const MidiLibraryEntry*> known;
+    for (const auto& entry : *previous) {
+        known[entry.path()] = &entry;
+    }
+    Entries entries;
+    vector<unsigned> stale;
+    for (const auto& dir : Directories()) {
+        for (const auto& path : system::getEntries(dir)) {
+            if (!IsMidiName(path)) {
+                continue;
+            }
+            struct stat st;
+            if (stat(path.c_str(), &st)) {
+                continue;
+            }
+            size_t lastSlash = path.rfind('/');
+            std::string filename = std::string::npos == lastSlash ? path : path.substr(lastSlash + 1);
+            auto found = known.find(dir + filename);
+            if (known.end() != found && found->second->indexed
+                    && found->second->mtime == (int64_t) st.st_mtime
+                    && found->second->size == (int64_t) st.st_size) {
+                entries.push_back(*found->second);
+                continue;
+            }
+            entries.emplace_back();
+            auto& entry = entries.back();
+            entry.directory = dir;
+            entry.filename = filename;
+            entry.mtime = st.st_mtime;
+            entry.size = st.st_size;
+            stale.push_back(entries.size() - 1);
+        }
+    }
+    bool changed = !stale.empty() || entries.size() != previous->size();
+    if (changed) {
+        this->publish(entries);     // new files are listed before they are parsed
+    }
+    unsigned count = 0;
+    for (unsigned index : stale) {
+        if (stop.load()) {
+            break;
+        }
+        Index(&entries[index]);
+        if (!(++count % LIBRARY_PUBLISH_INTERVAL)) {
+            this->publish(entries);
+        }
+    }
+    if (changed) {
+        this->publish(entries);
+        this->save(entries);
+    }
+    if (debugVerbose) DEBUG("%s %u files %u indexed", __func__, (unsigned) entries.size(), count);
+    refreshing.store(false);
+}
+
+std::string MidiLibraryEntry::summary() const {
+    if (!indexed) {
+        return "";
+    }
+    int total = (int) (seconds + .5);
+    char buffer[40];
+    snprintf(buffer, sizeof(buffer), "%d:%02d  %uch", total / 60, total % 60,
+            this->channelCount());
+    return buffer;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "SchmickleWorks.hpp"
+#include <memory>
+#include <thread>
+
+// what the load menu shows about a midi file; read once, and again only if the file changes
+struct MidiLibraryEntry {
+    std::string directory;
+    std::string filename;
+    int64_t mtime = 0;          // seconds since epoch file was last modified
+    int64_t size = 0;           // bytes
+    double seconds = 0;         // playing time, following tempo changes
+    unsigned tracks = 0;
+    unsigned noteCount = 0;
+    unsigned channels = 0;      // bit set for each channel with notes
+    int ppq = 0;
+    std::string instruments;    // track instrument names, or general midi names if none
+    bool indexed = false;       // false until parsed, or if file could not be parsed
+
+    unsigned channelCount() const {
+        unsigned count = 0;
+        for (unsigned bits = channels; bits; bits &= bits - 1) {
+            ++count;
+        }
+        return count;
+    }
+
+    void fromJson(json_t* root);
+    std::string path() const { return directory + filename; }
+    std::string summary() const;
+    json_t* toJson() const;
+};
+
+// midi files in the user directories, shared by every note taker
+// saved in the user directory, so the load menu opens without reading thousands of files;
+// a worker thread brings the index up to date, parsing only files that are new, or whose
+// modified time or size changed
+struct MidiLibrary {
+    enum class Sort : uint8_t {  // order matches UI
+        name,
+        newest,
+        longest,
+        mostNotes,
+    };
+
+    typedef vector<MidiLibraryEntry> Entries;
+
+    std::shared_ptr<const Entries> published;   // swapped atomically; replaced by worker
+    std::thread worker;
+    std::atomic<bool> refreshing { false };
+    std::atomic<bool> stop { false };           // set when plugin unloads; worker quits
+    Sort sort = Sort::name;                     // ui thread only
+    bool loaded = false;                        // index file has been read
+
+    ~MidiLibrary() {
+        stop.store(true);
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    static MidiLibrary& Shared() {
+        static MidiLibrary shared;
+        return shared;
+    }
+
+    static vector<std::string> Directories();
+
+    std::shared_ptr<const Entries> entries() const {
+        return std::atomic_load(&published);
+    }
+
+    static std::string IndexPath();
+    static bool IsMidiName(const std::string& );
+    void refresh();
+    vector<const MidiLibraryEntry*> sorted(const Entries& ) const;
+
+private:
+    static void Index(MidiLibraryEntry* );
+    void load();
+    void publish(const Entries& );
+    void save(const Entries& ) const;
+    void update(std::shared_ptr<const Entries> previous);
+};
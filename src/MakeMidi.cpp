@@ -1,7 +1,6 @@
 #include "Display.hpp"
 #include "MakeMidi.hpp"
 #include "Taker.hpp"
-#include <set>
 
 // to do : move this to NoteTakeChannel.cpp
 const NoteTakerChannel::Limit NoteTakerChannelLimits[] = {
@@ -16,24 +15,71 @@ void NoteTakerMakeMidi::createEmpty(vector<uint8_t>& midi) {
     DisplayNote dummy(NOTE_OFF);
     int last = 0;
     add_track_end(dummy, last);
-    this->standardTrailer(midi);
+    this->standardTrailer();
 }
 
-struct LastNote {
-    LastNote(const DisplayNote* n)
-        : note(n) {
+// bytes addNotes writes at most, so the buffer is sized once; each delta time counts as
+// the largest it can be
+size_t NoteTakerMakeMidi::MaxSize(const NoteTakerSlot& slot) {
+    const size_t delta = Size8(INT_MAX);
+    size_t size = 22;  // file header, track header, track length
+    for (const auto& chan : slot.channels) {
+        if (!chan.sequenceName.empty()) {
+            size += 8 + Size8(chan.sequenceName.length()) + chan.sequenceName.length();
+        }
+        if (!chan.instrumentName.empty()) {
+            size += 8 + Size8(chan.instrumentName.length()) + chan.instrumentName.length();
+        }
+        size += 3 + 4 * 4;  // program change, limits
     }
-
-    bool operator<(const LastNote& n) const { 
-        return note->endTime() < n.note->endTime() ||
-                (note->endTime() == n.note->endTime() && note->channel < n.note->channel);
+    for (const auto& n : slot.n.notes) {
+        switch (n.type) {
+            case NOTE_ON:
+                size += 2 * (delta + 3);  // note on, and its note off
+                break;
+            case KEY_SIGNATURE:
+                size += delta + 5;
+                break;
+            case TIME_SIGNATURE:
+                size += delta + 7;
+                break;
+            case MIDI_TEMPO:
+                size += delta + 6;
+                break;
+            case TRACK_END:
+                size += delta + 3;
+                break;
+            default:
+                ;
+        }
     }
-
-    const DisplayNote* note;
-};
+    return size;
+}
 
 void NoteTakerMakeMidi::createFromNotes(const NoteTakerSlot& slot, vector<uint8_t>& midi) {
     this->standardHeader(midi, slot.n.ppq);
+    midi.reserve(MaxSize(slot));
+    this->addNotes(slot);
+    this->standardTrailer();
+}
+
+// returns bytes written, or zero if dest could not be written
+size_t NoteTakerMakeMidi::writeFromNotes(const NoteTakerSlot& slot, FILE* dest) {
+    vector<uint8_t> buffer;
+    size_t chunk = STREAM_CHUNK;
+    buffer.reserve(std::min(MaxSize(slot), chunk * 2));
+    stream = dest;
+    streamFailed = false;
+    this->standardHeader(buffer, slot.n.ppq);
+    this->addNotes(slot);
+    this->standardTrailer();
+    size_t total = this->offset();
+    stream = nullptr;
+    target = nullptr;
+    return streamFailed ? 0 : total;
+}
+
+void NoteTakerMakeMidi::addNotes(const NoteTakerSlot& slot) {
     // after header, write channel dur/sus as control change 0xBx
                 // 0x57 release max mapped to duration index
                 // 0x58 release min
@@ -56,7 +102,7 @@ void NoteTakerMakeMidi::createFromNotes(const NoteTakerSlot& slot, vector<uint8_
             add_one(0x04);
             add_string(chan.instrumentName);
         }
-        if (chan.gmInstrument) {
+        if (chan.gmInstrument > 0) {
             add_size8(0);
             add_one(midiProgramChange + index);
             add_one(chan.gmInstrument);
@@ -70,38 +116,47 @@ void NoteTakerMakeMidi::createFromNotes(const NoteTakerSlot& slot, vector<uint8_
             }
         }
     }
-    std::set<LastNote> lastNotes;
+    // notes sounding, as a binary heap with the first to end on top; notes that end together
+    // on the same channel each get a note off
+    vector<const DisplayNote*> lastNotes;
+    lastNotes.reserve(CHANNEL_COUNT * 16);
+    auto endsLater = [](const DisplayNote* a, const DisplayNote* b) {
+        if (a->endTime() != b->endTime()) {
+            return a->endTime() > b->endTime();
+        }
+        if (a->channel != b->channel) {
+            return a->channel > b->channel;
+        }
+        return a->pitch() > b->pitch();
+    };
     int lastTime = 0;
+    // writes note offs up to time, so that events after them have no negative delta
+    auto addNoteOffs = [&](int time) {
+        while (!lastNotes.empty() && lastNotes.front()->endTime() <= time) {
+            add_note_off(*lastNotes.front(), &lastTime);
+            std::pop_heap(lastNotes.begin(), lastNotes.end(), endsLater);
+            lastNotes.pop_back();
+        }
+    };
     for (auto& n : slot.n.notes) {
         switch(n.type) {
             case NOTE_OFF:  // to do : use note off information rather than note on 
             case MIDI_HEADER:
                 break;
             case NOTE_ON:
-                while (!lastNotes.empty()) {
-                    auto off = lastNotes.begin()->note;
-                    if (off->endTime() > n.startTime) {
-                        DEBUG("%u break off %s", lastNotes.size(), off->debugString().c_str());
-                        break;
-                    }
-                    add_delta(off->endTime(), &lastTime);
-                    add_one(midiNoteOff + off->channel);
-                    add_one(off->pitch());
-                    add_one(off->offVelocity());
-                    lastNotes.erase(lastNotes.begin());
-                    DEBUG("%u write off %s", lastNotes.size(), off->debugString().c_str());
-                }
+                addNoteOffs(n.startTime);
                 add_delta(n.startTime, &lastTime);
                 add_one(midiNoteOn + n.channel);
                 add_one(n.pitch());
                 add_one(n.onVelocity());
-                lastNotes.insert(LastNote(&n));
-                DEBUG("%u write on %s", lastNotes.size(), n.debugString().c_str());
+                lastNotes.push_back(&n);
+                std::push_heap(lastNotes.begin(), lastNotes.end(), endsLater);
                 break;
             case REST_TYPE:
                 // assume there's nothing to do here
                 break;
             case KEY_SIGNATURE:
+                addNoteOffs(n.startTime);
                 add_delta(n.startTime, &lastTime);
                 add_one(midiMetaEvent);
                 add_one(midiKeySignature);
@@ -110,6 +165,7 @@ void NoteTakerMakeMidi::createFromNotes(const NoteTakerSlot& slot, vector<uint8_
                 add_one(n.minor());
                 break;
             case TIME_SIGNATURE:
+                addNoteOffs(n.startTime);
                 add_delta(n.startTime, &lastTime);
                 add_one(midiMetaEvent);
                 add_one(midiTimeSignature);
@@ -120,6 +176,7 @@ void NoteTakerMakeMidi::createFromNotes(const NoteTakerSlot& slot, vector<uint8_
                 add_one(n.notated32NotesPerQuarterNote());
                 break;
             case MIDI_TEMPO:
+                addNoteOffs(n.startTime);
                 add_delta(n.startTime, &lastTime);
                 add_one(midiMetaEvent);
                 add_one(midiSetTempo);
@@ -127,19 +184,13 @@ void NoteTakerMakeMidi::createFromNotes(const NoteTakerSlot& slot, vector<uint8_
                 add_size24(n.tempo());
                 break;
             case TRACK_END:
-                for (auto last : lastNotes) {
-                    auto off = last.note;
-                    add_delta(off->endTime(), &lastTime);
-                    add_one(midiNoteOff + off->channel);
-                    add_one(off->pitch());
-                    add_one(off->offVelocity());
-                }
+                addNoteOffs(INT_MAX);
                 add_track_end(n, lastTime);
                 break;
             default:
                 // to do : incomplete
                 _schmickled();
         }
+        this->flush(false);
     }
-    this->standardTrailer(midi);
 }
@@ -15,9 +15,17 @@ inline float MidiToSeconds(int midiTime, int ppq) {
 static constexpr array<uint8_t, 4> MThd = {'M', 'T', 'h', 'd'}; // MIDI file header
 static constexpr array<uint8_t, 4> MTrk = {'M', 'T', 'r', 'k'}; // MIDI track header
 
+// writes midi into target; if stream is set, target is a buffer written to the stream as it
+// fills, so a large slot is saved without holding the whole file in memory
+// the track length is written as zero and patched once the track ends
 struct NoteTakerMakeMidi {
-    vector<uint8_t>* target = nullptr;  // used only during constructing midi, to compute track length
-    vector<uint8_t> temp;
+    static constexpr size_t STREAM_CHUNK = 64 * 1024;  // bytes buffered before stream write
+
+    vector<uint8_t>* target = nullptr;
+    FILE* stream = nullptr;
+    size_t streamed = 0;                // bytes of target already written to stream
+    size_t trackLengthAt = 0;           // offset of track length, patched when track ends
+    bool streamFailed = false;
 
     void add_delta(int midiTime, int* lastTime) {
         int delta = midiTime - *lastTime;
@@ -29,6 +37,13 @@ struct NoteTakerMakeMidi {
         *lastTime = midiTime;
     }
 
+    void add_note_off(const DisplayNote& off, int* lastTime) {
+        add_delta(off.endTime(), lastTime);
+        add_one(midiNoteOff + off.channel);
+        add_one(off.pitch());
+        add_one(off.offVelocity());
+    }
+
     void add_one(unsigned char c) {
         target->push_back(c);
     }
@@ -94,26 +109,64 @@ struct NoteTakerMakeMidi {
         add_one(0);  // number of bytes of data to follow
     }
 
+    void addNotes(const NoteTakerSlot& );
     void createEmpty(vector<uint8_t>& midi);
     void createFromNotes(const NoteTakerSlot& , vector<uint8_t>& midi);
 
+    // writes buffer to stream once it holds a chunk, or if all is set, whatever it holds
+    void flush(bool all) {
+        if (!stream || target->empty() || (!all && target->size() < STREAM_CHUNK)) {
+            return;
+        }
+        size_t wrote = fwrite(target->data(), 1, target->size(), stream);
+        streamFailed |= wrote != target->size();
+        streamed += target->size();
+        target->clear();
+    }
+
+    static size_t MaxSize(const NoteTakerSlot& );
+
+    // total bytes written, including any already streamed
+    size_t offset() const {
+        return streamed + target->size();
+    }
+
+    static unsigned Size8(int size) {
+        unsigned bytes = 1;
+        for (unsigned value = (unsigned) size; (value >>= 7); ) {
+            ++bytes;
+        }
+        return bytes;
+    }
+
     void standardHeader(vector<uint8_t>& midi, int ppq) {
         target = &midi;
         target->clear();
+        streamed = 0;
         target->insert(target->end(), MThd.begin(), MThd.end());
         add_size32(6);  // number of bytes of data to follow
         add_size16(0);  // hardcode to format 0; to do : support writing format 1 ?
         add_size16(1);  // hardcode to 1 track
         add_size16(ppq);
         target->insert(target->end(), MTrk.begin(), MTrk.end());
-    // defer adding until size of data is known
-        temp.clear();
-        target = &temp;
+        // patched by trailer once size of data is known
+        trackLengthAt = this->offset();
+        add_size32(0);
     }
 
-    void standardTrailer(vector<uint8_t>& midi) {
-        target = &midi;
-        add_size32(temp.size());
-        midi.insert(target->end(), temp.begin(), temp.end());
+    void standardTrailer() {
+        uint32_t length = this->offset() - trackLengthAt - 4;
+        uint8_t bytes[4] = { (uint8_t) (length >> 24), (uint8_t) (length >> 16),
+                (uint8_t) (length >> 8), (uint8_t) length };
+        if (trackLengthAt >= streamed) {
+            std::copy(bytes, bytes + 4, target->begin() + (trackLengthAt - streamed));
+            this->flush(true);
+            return;
+        }
+        this->flush(true);
+        streamFailed |= fseek(stream, trackLengthAt, SEEK_SET)
+                || 4 != fwrite(bytes, 1, 4, stream) || fseek(stream, 0, SEEK_END);
     }
+
+    size_t writeFromNotes(const NoteTakerSlot& , FILE* );
 };
@@ -1,3 +1,5 @@
+#include <string.h>
+#include <unordered_map>
 #include "Notes.hpp"
 #include "Channel.hpp"
 #include "Display.hpp"
@@ -120,6 +122,57 @@ std::string Notes::TSUnit(const DisplayNote* note, int count, int ppq) {
     return result;
 }
 
+// notes loaded by any note taker, by hash; entries expire when no slot holds the notes
+static std::unordered_multimap<size_t, std::weak_ptr<const vector<DisplayNote>>> sharedNotes;
+
+static size_t HashNotes(const vector<DisplayNote>& notes) {
+    uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&hash](const void* bytes, size_t count) {
+        for (size_t index = 0; index < count; ++index) {
+            hash = (hash ^ ((const uint8_t*) bytes)[index]) * 0x100000001b3;
+        }
+    };
+    for (const auto& note : notes) {
+        mix(&note.startTime, sizeof(note.startTime));
+        mix(&note.duration, sizeof(note.duration));
+        mix(note.data, sizeof(note.data));
+        mix(&note.channel, sizeof(note.channel));
+        mix(&note.voice, sizeof(note.voice));
+        mix(&note.type, sizeof(note.type));
+    }
+    return (size_t) hash;
+}
+
+// DisplayNote::operator== compares only what sorting needs; sharing needs every field
+static bool SameNotes(const vector<DisplayNote>& left, const vector<DisplayNote>& right) {
+    return left.size() == right.size() && std::equal(left.begin(), left.end(), right.begin(),
+            [](const DisplayNote& l, const DisplayNote& r) {
+        return l.startTime == r.startTime && l.duration == r.duration
+                && !memcmp(l.data, r.data, sizeof(l.data)) && l.channel == r.channel
+                && l.voice == r.voice && l.type == r.type;
+    });
+}
+
+// called by ui thread after loading notes; holds notes another slot loaded, if any
+void NoteBuffer::share() {
+    if (1 != shared.use_count()) {
+        return;  // already shared
+    }
+    size_t hash = HashNotes(*shared);
+    auto range = sharedNotes.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        auto candidate = iter->second.lock();
+        if (candidate && SameNotes(*candidate, *shared)) {
+            shared = candidate;
+            return;
+        }
+    }
+    for (auto iter = sharedNotes.begin(); iter != sharedNotes.end(); ) {
+        iter = iter->second.expired() ? sharedNotes.erase(iter) : std::next(iter);
+    }
+    sharedNotes.emplace(hash, shared);
+}
+
 void Notes::AddNoteOff(vector<DisplayNote>& notes) {
     vector<DisplayNote> add;
     for (unsigned index = 0; index < notes.size(); ++index) {
@@ -139,7 +192,8 @@ void Notes::AddNoteOff(vector<DisplayNote>& notes) {
 // to do : if too few notes are of the right duration, they (probably) need to be drawn as ties --
 // 2/3rds of 1/4 note is 1/6 (.167) which could be 1/8 + 1/32 (.156)
 // This adds beam position records for each triplet and keep that index rather than trip id.
-void Notes::findTriplets(DisplayCache* displayCache) {
+// sets where notes fall in triplets in the display cache, and adds a beam for each triplet
+void Notes::findTriplets(DisplayCache* displayCache) const {
 #if DEBUG_TRIPLET_DRAW
     DEBUG("%s", __func__);
     auto noteTripletDebug = [=](const char* str, const DisplayNote& note) {
@@ -149,16 +203,18 @@ void Notes::findTriplets(DisplayCache* displayCache) {
     auto noteTripletDebug = [](const char* , const DisplayNote& ) {};
 #endif
     // if clearing one or all, clear tuplets as needed, but only if tuplet isn't closed
-    auto clearTriplet = [=](TripletCandidate* candidate, unsigned channel) {
+    vector<PositionType>& triplets = displayCache->triplets;
+    triplets.assign(notes.size(), PositionType::none);
+    auto clearTriplet = [&](TripletCandidate* candidate, unsigned channel) {
             if (candidate->startIndex >= notes.size()) {
                 return;
             }
-            if (PositionType::right != notes[candidate->lastIndex].triplet) {
+            if (PositionType::right != triplets[candidate->lastIndex]) {
                 for (unsigned index = candidate->startIndex; index <= candidate->lastIndex; ++index) {
                     if (channel != notes[index].channel) {
                         continue;
                     }
-                    notes[index].triplet = PositionType::none;
+                    triplets[index] = PositionType::none;
                 }
             }
             *candidate = TripletCandidate();
@@ -167,7 +223,7 @@ void Notes::findTriplets(DisplayCache* displayCache) {
     array<TripletCandidate, CHANNEL_COUNT> tripStarts;  // first index in notes (not cache) of triplet
     tripStarts.fill(TripletCandidate());
     for (unsigned index = 0; index < notes.size(); ++index) {
-        DisplayNote& note = notes[index];
+        const DisplayNote& note = notes[index];
         if (NOTE_OFF == note.type) {
             continue;
         }
@@ -187,7 +243,7 @@ void Notes::findTriplets(DisplayCache* displayCache) {
         }
         ;
         if (INT_MAX != candidate.lastIndex) {
-            DisplayNote* last = &notes[candidate.lastIndex];
+            const DisplayNote* last = &notes[candidate.lastIndex];
             // if chord notes overlap or are of different lengths, don't look for triplets
             if (last->startTime == note.startTime)  {
                 if (last->duration != note.duration) {
@@ -216,7 +272,7 @@ void Notes::findTriplets(DisplayCache* displayCache) {
             noteTripletDebug("not one note", note);
             continue;
         }
-        DisplayNote* test = &notes[candidate.startIndex];
+        const DisplayNote* test = &notes[candidate.startIndex];
         int totalDuration = note.endTime() - test->startTime;
         if ((NoteDurations::InStd(totalDuration, ppq) % 3)) {
 #if DEBUG_TRIPLET_DRAW
@@ -226,10 +282,10 @@ void Notes::findTriplets(DisplayCache* displayCache) {
             continue;
         }
         // triplet in cache begins at can trip start time, ends at note end time
-        notes[candidate.startIndex].triplet = PositionType::left;
+        triplets[candidate.startIndex] = PositionType::left;
         noteTripletDebug("left", *test);
         int chan = test->channel;
-        DisplayNote* last = test;
+        const DisplayNote* last = test;
         while (++test < &note) {
             if (test->channel != chan) {
                 continue;
@@ -238,11 +294,11 @@ void Notes::findTriplets(DisplayCache* displayCache) {
                 continue;
             }
             last = test;
-            test->triplet = PositionType::mid;
+            triplets[test - &notes.front()] = PositionType::mid;
             noteTripletDebug("mid", *test);
         }
         unsigned rightIndex = &note - &notes.front();
-        note.triplet = PositionType::right;
+        triplets[rightIndex] = PositionType::right;
         noteTripletDebug("right", note);
         // note indices are replaced with cache indices in cache builder cache tuplets
         beams->emplace_back(candidate.startIndex, rightIndex, true);
@@ -258,23 +314,23 @@ void Notes::insertNote(unsigned insertLoc, int startTime, int duration, unsigned
     iNote.setPitchData(pitch);
     selectStart += 1;
     selectEnd = selectStart + 1;
-    notes.insert(notes.begin() + insertLoc, iNote);
+    notes.insert(insertLoc, iNote);
     DisplayNote noteOff(NOTE_OFF, startTime + duration, 0, (uint8_t) channel);
     noteOff.setPitchData(pitch);
-    auto iter = notes.begin() + insertLoc;
-    while (*iter < noteOff) {
-        ++iter;
+    unsigned offLoc = insertLoc;
+    while (notes[offLoc] < noteOff) {
+        ++offLoc;
     }
-    notes.insert(iter, noteOff);
+    notes.insert(offLoc, noteOff);
 }
 
 // cache may be null if note is rest and rest part is disabled
-const NoteCache* Notes::lastCache(unsigned index) const {
+const NoteCache* Notes::lastCache(const DisplayCache& cache, unsigned index) const {
     unsigned used = index;
-    while (used && !notes[used].cache) {
+    while (used && !cache.byNote[used]) {
         --used;
     }
-    const NoteCache* result = notes[used].cache;
+    const NoteCache* result = cache.byNote[used];
     if (index == used && result) {
         result -= 1;
     }
@@ -313,6 +369,7 @@ void Notes::setSlurs(unsigned selectChannels, bool condition) {
 #endif
     array<DisplayNote*, CHANNEL_COUNT> last;
     last.fill(nullptr);
+    auto& notes = this->notes.edit();
     for (unsigned index = selectStart; index < selectEnd; ++index) {
         auto& note = notes[index];
         if (!note.isSelectable(selectChannels)) {
@@ -353,6 +410,7 @@ void Notes::setTriplets(unsigned selectChannels, bool condition) {
     int denom = condition ? 3 : 2;
     int modulo = condition ? 9 : 3;  //  3 non-trips (3*2^n) : 3 trips (2^n)
     int sign = condition ? -1 : 1;
+    auto& notes = this->notes.edit();
     for (unsigned index = selectStart; index < selectEnd; ++index) {
         auto& note = notes[index];
         if (!note.isSelectable(selectChannels)) {
@@ -443,6 +501,7 @@ bool Notes::slursOrTies(unsigned selectChannels, HowMany howMany, bool* atLeastO
 
 void Notes::sortOffNote(const DisplayNote* note, const DisplayNote& oldOff,
         const DisplayNote& newOff) {
+    auto& notes = this->notes.edit();  // note points into notes, so they are already unshared
     vector<DisplayNote>::iterator oldOffLoc = notes.end();
     vector<DisplayNote>::iterator newOffLoc = notes.end();
     for (auto iter = notes.begin() + (note - &notes.front()); iter != notes.end(); ++iter) {
@@ -535,9 +594,9 @@ bool Notes::triplets(unsigned selectChannels, HowMany howMany) const {
     return false;
 }
 
-bool Notes::Deserialize(const vector<uint8_t>& storage, vector<DisplayNote>* notes, int* ppq) {
+bool Notes::Deserialize(MidiSpan storage, vector<DisplayNote>* notes, int* ppq) {
     NoteTakerParseMidi midiParser(storage, notes, ppq, nullptr);
-    vector<uint8_t>::const_iterator iter = midiParser.midi.begin();
+    MidiSpan::const_iterator iter = midiParser.midi.begin();
     DisplayNote note(NOTE_OFF);
     int lastSuccess = 0;
     notes->clear();
@@ -580,6 +639,7 @@ bool Notes::Deserialize(const vector<uint8_t>& storage, vector<DisplayNote>* not
 }
 
 void Notes::eraseNotes(unsigned start, unsigned end, unsigned selectChannels) {
+    auto& notes = this->notes.edit();
     for (auto iter = notes.begin() + end; iter-- != notes.begin() + start; ) {
         if (iter->isSelectable(selectChannels)) {
             if (NOTE_ON == iter->type) {
@@ -772,7 +832,18 @@ void Notes::fixCollisionDuration(DisplayNote* note) {
 void Notes::Serialize(const vector<DisplayNote>& notes, vector<uint8_t>& storage) {
     NoteTakerMakeMidi midiMaker;
     midiMaker.target = &storage;
+    size_t total = 0;
     int lastStart = 0;
+    for (auto& note : notes) {
+        total += NoteTakerMakeMidi::Size8(note.startTime - lastStart)
+                + NoteTakerMakeMidi::Size8(note.duration) + 1;
+        for (unsigned index = 0; index < 4; ++index) {
+            total += NoteTakerMakeMidi::Size8(note.data[index]);
+        }
+        lastStart = note.startTime;
+    }
+    storage.reserve(storage.size() + total);
+    lastStart = 0;
     for (auto& note : notes) {
         if (note.duration < 0) {
             DEBUG("[%d / %u] dur < 0", &note - &notes.front(), notes.size());
@@ -832,40 +903,40 @@ bool Notes::transposeSpan(vector<DisplayNote>& span) {
     return true;
 }
 
-int Notes::xPosAtEndStart() const {
+int Notes::xPosAtEndStart(const DisplayCache& cache) const {
     unsigned endStart = selectEnd - 1;
-    while (!notes[endStart].cache) {
+    while (!cache.byNote[endStart]) {
         ++endStart;
         SCHMICKLE(endStart < notes.size());
     }
-    return notes[endStart].cache->xPosition;
+    return cache.byNote[endStart]->xPosition;
 }
 
-int Notes::xPosAtEndEnd(const DisplayState& state) const {
+int Notes::xPosAtEndEnd(const DisplayCache& cache, const DisplayState& state) const {
     unsigned endEnd = selectEnd - 1;
     const NoteCache* noteCache;
-    while (!(noteCache = notes[endEnd].cache)) {
+    while (!(noteCache = cache.byNote[endEnd])) {
         ++endEnd;
         SCHMICKLE(endEnd < notes.size());
     }
     return NoteTakerDisplay::XEndPos(*noteCache, state.vg);
 }
 
-int Notes::xPosAtStartEnd() const {
+int Notes::xPosAtStartEnd(const DisplayCache& cache) const {
     unsigned startEnd = this->selectEndPos(selectStart);
-    while (!notes[startEnd].cache) {
+    while (!cache.byNote[startEnd]) {
         ++startEnd;
         SCHMICKLE(startEnd < notes.size());
     }
-    return notes[startEnd].cache->xPosition;
+    return cache.byNote[startEnd]->xPosition;
 }
 
-int Notes::xPosAtStartStart() const {
+int Notes::xPosAtStartStart(const DisplayCache& cache) const {
     unsigned start = selectStart;
-    while (!notes[start].cache) {
+    while (!cache.byNote[start]) {
         ++start;
         SCHMICKLE(start < notes.size());
     }
-    return notes[start].cache->xPosition;
+    return cache.byNote[start]->xPosition;
 }
 
@@ -6,6 +6,102 @@ struct DisplayCache;
 struct DisplayState;
 struct NoteTakerDisplay;
 
+// read-only bytes of a midi file or buffer, without owning them: a file mapped into memory
+// or a vector; parsing works the same over either
+struct MidiSpan {
+    typedef const uint8_t* const_iterator;
+
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+
+    MidiSpan() {
+    }
+
+    MidiSpan(const uint8_t* d, size_t len)
+        : data(d)
+        , length(len) {
+    }
+
+    MidiSpan(const vector<uint8_t>& v)  // caller keeps vector alive while span is in use
+        : data(v.data())
+        , length(v.size()) {
+    }
+
+    const_iterator begin() const { return data; }
+    const_iterator end() const { return data + length; }
+    const uint8_t& back() const { return data[length - 1]; }
+    bool empty() const { return !length; }
+    const uint8_t& front() const { return data[0]; }
+    size_t size() const { return length; }
+    const uint8_t& operator[](size_t index) const { return data[index]; }
+};
+
+// notes of a score, shared by every slot holding the same score in this and other note
+// takers, so a patch of note takers playing the same scores keeps one copy of each
+// reads share them; the first edit copies them if another slot holds them too
+// shared only by the ui thread; the audio thread plays from timelines built from them
+struct NoteBuffer {
+    typedef vector<DisplayNote>::const_iterator const_iterator;
+
+    NoteBuffer()
+        : shared(std::make_shared<vector<DisplayNote>>()) {
+    }
+
+    operator const vector<DisplayNote>&() const { return *shared; }
+    const DisplayNote& back() const { return shared->back(); }
+    const_iterator begin() const { return shared->begin(); }
+    bool empty() const { return shared->empty(); }
+    const_iterator end() const { return shared->end(); }
+    const DisplayNote& front() const { return shared->front(); }
+    size_t size() const { return shared->size(); }
+    const DisplayNote& operator[](size_t index) const { return (*shared)[index]; }
+
+    // starts a new buffer, leaving the old one to slots that share it
+    void assign(vector<DisplayNote>&& notes) {
+        shared = std::make_shared<vector<DisplayNote>>(std::move(notes));
+    }
+
+    void clear() {
+        this->assign(vector<DisplayNote>());
+    }
+
+    // edits take indices rather than iterators, since editing may copy notes
+    void erase(unsigned first, unsigned last) {
+        auto& notes = this->edit();
+        notes.erase(notes.begin() + first, notes.begin() + last);
+    }
+
+    void insert(unsigned index, const DisplayNote& note) {
+        auto& notes = this->edit();
+        notes.insert(notes.begin() + index, note);
+    }
+
+    void insert(unsigned index, const vector<DisplayNote>& span) {
+        auto& notes = this->edit();
+        notes.insert(notes.begin() + index, span.begin(), span.end());
+    }
+
+    // returns notes to change; copies them first if another slot holds them, so take
+    // pointers into notes only after calling this
+    vector<DisplayNote>& edit() {
+        if (1 != shared.use_count()) {
+            shared = std::make_shared<vector<DisplayNote>>(*shared);
+        }
+        // shared points to a buffer made here as non-const, now held only by this
+        return const_cast<vector<DisplayNote>&>(*shared);
+    }
+
+    bool sharedWith(const NoteBuffer& other) const {
+        return shared == other.shared;
+    }
+
+    // holds equal notes loaded by another slot instead, if any
+    void share();
+
+private:
+    std::shared_ptr<const vector<DisplayNote>> shared;
+};
+
 struct TripletCandidate {
     unsigned lastIndex = INT_MAX;
     unsigned startIndex = INT_MAX;
@@ -15,7 +111,7 @@ struct TripletCandidate {
 // break out notes and range so that preview can draw notes without instantiated module
 // to do : add dirty bit and cache serialized form for autosave (make notes private?)
 struct Notes {
-    vector<DisplayNote> notes;
+    NoteBuffer notes;
     unsigned selectStart = 0;           // index into notes of first selected (any channel)
     unsigned selectEnd = 1;             // one past last selected
     int ppq = stdTimePerQuarterNote;    // default to 96 pulses/ticks per quarter note
@@ -26,8 +122,7 @@ struct Notes {
     };
 
     Notes() {
-        notes.emplace_back(MIDI_HEADER);
-        notes.emplace_back(TRACK_END);
+        notes.assign({ DisplayNote(MIDI_HEADER), DisplayNote(TRACK_END) });
     }
 
     static void AddNoteOff(vector<DisplayNote>& notes);
@@ -39,25 +134,30 @@ struct Notes {
         ppq = stdTimePerQuarterNote;
     }
 
+    // notes are sorted by start time, so binary search finds first note at or after time
     unsigned atMidiTime(int midiTime) const {
-        for (unsigned index = 0; index < notes.size(); ++index) {
+        unsigned index = std::lower_bound(notes.begin(), notes.end(), midiTime,
+                [](const DisplayNote& note, int time) {
+                    return note.startTime < time;
+                }) - notes.begin();
+        // skip meta events at time to the first note or rest there
+        for (; index < notes.size(); ++index) {
             const DisplayNote& note = notes[index];
-            if (midiTime < note.startTime || TRACK_END == note.type
-                    || (note.isNoteOrRest() && midiTime == note.startTime)) {
+            if (midiTime < note.startTime || TRACK_END == note.type || note.isNoteOrRest()) {
                 return index;
             }
         }
         return _schmickle_false();  // should have hit track end
     }
 
-    void findTriplets(DisplayCache* displayCache);
+    void findTriplets(DisplayCache* displayCache) const;
 #if DEBUG_STD
     const DisplayNote& d(unsigned index) const;
 #endif
     static void DebugDump(const vector<DisplayNote>& , unsigned start = 0,
             unsigned end = INT_MAX, const vector<NoteCache>* xPos = nullptr,
             unsigned selectStart = INT_MAX, unsigned selectEnd = INT_MAX);
-    static bool Deserialize(const vector<uint8_t>& , vector<DisplayNote>* , int* ppq);
+    static bool Deserialize(MidiSpan , vector<DisplayNote>* , int* ppq);
     void eraseNotes(unsigned start, unsigned end, unsigned selectChannels);
     // truncates / expands duration preventing note from colliding with same pitch later on 
     void fixCollisionDuration(DisplayNote* );
@@ -98,7 +198,7 @@ struct Notes {
     void insertNote(unsigned insertLoc, int startTime, int duration, unsigned channel, int pitch);
     bool isEmpty(unsigned selectChannels) const;
     static std::string KeyName(int key, int minor);
-    const NoteCache* lastCache(unsigned index) const;
+    const NoteCache* lastCache(const DisplayCache& , unsigned index) const;
 
     static int LastEndTime(const vector<DisplayNote>& notes) {
         int result = 0;
@@ -181,7 +281,7 @@ struct Notes {
     static void Serialize(const vector<DisplayNote>& , vector<uint8_t>& );
 
     void shift(unsigned start, int diff, unsigned selectChannels = ALL_CHANNELS) {
-        if (Notes::ShiftNotes(notes, start, diff, selectChannels)) {
+        if (Notes::ShiftNotes(notes.edit(), start, diff, selectChannels)) {
             this->sort();
         }
     }
@@ -219,17 +319,18 @@ struct Notes {
 
     void sort() {
         if (debugVerbose) DEBUG("sort notes");
-        const auto& first = notes[selectStart];
-        const auto& last = notes[selectEnd - 1];
-        std::sort(notes.begin(), notes.end());
+        auto& sorted = notes.edit();
+        const auto& first = sorted[selectStart];
+        const auto& last = sorted[selectEnd - 1];
+        std::sort(sorted.begin(), sorted.end());
         // sort may move selection end (and maybe start?)
         // set up select start / end after sorting to where they landed
-        auto firstIter = std::lower_bound(notes.begin(), notes.end(), first);
-        SCHMICKLE(firstIter != notes.end() && !(first < *firstIter));
-        selectStart = firstIter - notes.begin();
-        auto lastIter = std::lower_bound(notes.begin(), notes.end(), last);
-        SCHMICKLE(lastIter != notes.end() && !(last < *lastIter));
-        selectEnd = lastIter - notes.begin() + 1;
+        auto firstIter = std::lower_bound(sorted.begin(), sorted.end(), first);
+        SCHMICKLE(firstIter != sorted.end() && !(first < *firstIter));
+        selectStart = firstIter - sorted.begin();
+        auto lastIter = std::lower_bound(sorted.begin(), sorted.end(), last);
+        SCHMICKLE(lastIter != sorted.end() && !(last < *lastIter));
+        selectEnd = lastIter - sorted.begin() + 1;
     }
 
     void sortOffNote(const DisplayNote* note, const DisplayNote& oldOff, const DisplayNote& newOff);
@@ -245,8 +346,8 @@ struct Notes {
     bool validate(bool assertOnFailure = true) const;
     static bool Validate(const vector<DisplayNote>& notes, bool assertOnFailure = true,
             bool requireHeaderTrailer = true);
-    int xPosAtEndEnd(const DisplayState& ) const;
-    int xPosAtEndStart() const;
-    int xPosAtStartEnd() const;
-    int xPosAtStartStart() const;
+    int xPosAtEndEnd(const DisplayCache& , const DisplayState& ) const;
+    int xPosAtEndStart(const DisplayCache& ) const;
+    int xPosAtStartEnd(const DisplayCache& ) const;
+    int xPosAtStartStart(const DisplayCache& ) const;
 };
@@ -1,14 +1,47 @@
 #pragma once
 
 #include "Taker.hpp"
+#include <atomic>
+
+struct ParsedTrack;
+
+// shared by a parser on a worker thread and the ui thread showing how far it has read
+struct ParseProgress {
+    std::atomic<size_t> bytes { 0 };    // track bytes parsed
+    std::atomic<size_t> total { 0 };    // file size
+    std::atomic<bool> cancel { false }; // set by ui thread; parser stops at next check
+
+    void reset(size_t fileSize) {
+        bytes.store(0, std::memory_order_relaxed);
+        total.store(fileSize, std::memory_order_relaxed);
+        cancel.store(false, std::memory_order_relaxed);
+    }
+
+    void add(size_t parsed) {
+        bytes.fetch_add(parsed, std::memory_order_relaxed);
+    }
+
+    bool cancelled() const {
+        return cancel.load(std::memory_order_relaxed);
+    }
+
+    float fraction() const {
+        size_t size = total.load(std::memory_order_relaxed);
+        return size ? std::min(1.f, (float) bytes.load(std::memory_order_relaxed) / size) : 0;
+    }
+};
 
 struct NoteTakerParseMidi {
-    const vector<uint8_t>& midi;
+    MidiSpan midi;
     vector<DisplayNote>* displayNotes;
     array<NoteTakerChannel, CHANNEL_COUNT>* channels;
     int* ntPpq;
+    ParseProgress* progress = nullptr;  // if set, parse reports bytes read and may be cancelled
+    // if set, receives names and general midi instruments read from file, by original channel
+    array<NoteTakerChannel, CHANNEL_COUNT>* channelInfo = nullptr;
+    bool quiet = false;     // if set, parse logs nothing; set when indexing many files
 
-    NoteTakerParseMidi(const vector<uint8_t>& m, vector<DisplayNote>* notes, int* ppq,
+    NoteTakerParseMidi(MidiSpan m, vector<DisplayNote>* notes, int* ppq,
             array<NoteTakerChannel, CHANNEL_COUNT>* chans)
         : midi(m)
         , displayNotes(notes)
@@ -18,10 +51,16 @@ struct NoteTakerParseMidi {
     }
 
     bool parseMidi();
+    bool parseTrack(ParsedTrack* , const DisplayNote& header,
+            array<NoteTakerChannel, CHANNEL_COUNT>* chans,
+            array<uint8_t, CHANNEL_COUNT>* reassign) const;
 
-    static void DebugDumpRawMidi(const vector<uint8_t>& v);
+    static void DebugDumpRawMidi(MidiSpan v);
 
-    void debug_out(vector<uint8_t>::const_iterator& iter, int lastSuccess = 0) const {
+    void debug_out(MidiSpan::const_iterator& iter, int lastSuccess = 0) const {
+        if (quiet) {
+            return;
+        }
         DEBUG("%s midi size %u iter %u", __func__, midi.size(), &*iter - &midi.front());
         std::string s;
         auto start = std::max(&midi.front() + lastSuccess, &*iter - 25);
@@ -39,7 +78,7 @@ struct NoteTakerParseMidi {
     }
 
     template<std::size_t size>
-    bool match_midi(vector<uint8_t>::const_iterator& iter, const std::array<uint8_t, size>& data) {
+    bool match_midi(MidiSpan::const_iterator& iter, const std::array<uint8_t, size>& data) {
         for (auto dataIter = data.begin(); dataIter != data.end(); ++dataIter) {
             if (*iter != *dataIter) {
                 return false;
@@ -57,7 +96,7 @@ struct NoteTakerParseMidi {
         return true;
     }
 
-    bool midi_check7bits(vector<uint8_t>::const_iterator& iter, const char* label, int time) const {
+    bool midi_check7bits(MidiSpan::const_iterator& iter, const char* label, int time) const {
         if (iter == midi.end()) {
             DEBUG("%d looking for %s: unexpected end of file", time, label);
             return false;
@@ -68,7 +107,7 @@ struct NoteTakerParseMidi {
         return midi_check7bits(*iter, label, time);
     }
 
-    bool midi_delta(vector<uint8_t>::const_iterator& iter, int* result) const {
+    bool midi_delta(MidiSpan::const_iterator& iter, int* result) const {
         int delta;
         if (!midi_size8(iter, &delta)) {
             return false;
@@ -77,8 +116,8 @@ struct NoteTakerParseMidi {
         return true;
     }
 
-    static bool Midi_Size8(vector<uint8_t>::const_iterator end,
-            vector<uint8_t>::const_iterator& iter, int* result) {
+    static bool Midi_Size8(MidiSpan::const_iterator end,
+            MidiSpan::const_iterator& iter, int* result) {
         *result = 0;
         uint8_t byte;
         do {
@@ -92,11 +131,11 @@ struct NoteTakerParseMidi {
         return true;
     }
 
-    bool midi_size8(vector<uint8_t>::const_iterator& iter, int* result) const {
+    bool midi_size8(MidiSpan::const_iterator& iter, int* result) const {
         return Midi_Size8(midi.end(), iter, result);
     }
 
-    bool midi_size24(vector<uint8_t>::const_iterator& iter, int* result) const {
+    bool midi_size24(MidiSpan::const_iterator& iter, int* result) const {
         if (iter + 3 >= midi.end()) {
             return false;
         }
@@ -108,7 +147,7 @@ struct NoteTakerParseMidi {
         return true;
     }
 
-    bool midi_size32(vector<uint8_t>::const_iterator& iter, int* result) const {
+    bool midi_size32(MidiSpan::const_iterator& iter, int* result) const {
         if (iter + 4 >= midi.end()) {
             return false;
         }
@@ -120,7 +159,7 @@ struct NoteTakerParseMidi {
         return true;
     }
 
-    bool read_midi16(vector<uint8_t>::const_iterator& iter, int* store) {
+    bool read_midi16(MidiSpan::const_iterator& iter, int* store) {
         if (iter + 1 >= midi.end()) {
             return false;
         }
@@ -130,8 +169,8 @@ struct NoteTakerParseMidi {
     }
 
 #if 0
-    int safeMidi_size8(vector<uint8_t>::const_iterator& limit,
-            vector<uint8_t>::const_iterator& iter, int ppq);
+    int safeMidi_size8(MidiSpan::const_iterator& limit,
+            MidiSpan::const_iterator& iter, int ppq);
 #endif
 
 };
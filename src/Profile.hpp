@@ -0,0 +1,154 @@
+#pragma once
+
+#include "SchmickleWorks.hpp"
+#include <atomic>
+#include <chrono>
+
+// process() timing, kept by every note taker so a spiking instance can be found in a patch
+// written only by the audio thread and read by the ui thread, so counters are atomics that are
+// loaded and stored rather than incremented with a locked instruction
+// only samples that do work are timed; samples skipped by the event horizon are just counted
+struct ProcessProfile {
+    enum Phase {
+        requests,       // requests drained, inputs read, clock followed
+        advance,        // expired events stepped over, slot changes
+        notes,          // notes started, transpose applied
+        expander,       // super 8s published, event horizon computed
+        total,
+        PHASE_COUNT
+    };
+
+    // bucket n counts calls taking less than 250 ns << n; last bucket counts all slower calls
+    static constexpr unsigned BUCKET_COUNT = 16;
+    static constexpr unsigned FIRST_BUCKET_NS = 250;
+
+    struct Histogram {
+        array<std::atomic<uint32_t>, BUCKET_COUNT> buckets;
+        std::atomic<uint32_t> worst;    // nanoseconds
+
+        Histogram() {
+            this->clear();
+        }
+
+        void add(uint32_t ns) {
+            unsigned bucket = 0;
+            while (bucket < BUCKET_COUNT - 1 && ns >= FIRST_BUCKET_NS << bucket) {
+                ++bucket;
+            }
+            Bump(buckets[bucket]);
+            if (ns > worst.load(std::memory_order_relaxed)) {
+                worst.store(ns, std::memory_order_relaxed);
+            }
+        }
+
+        void clear() {
+            for (auto& bucket : buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            worst.store(0, std::memory_order_relaxed);
+        }
+
+        uint32_t count() const {
+            uint32_t result = 0;
+            for (const auto& bucket : buckets) {
+                result += bucket.load(std::memory_order_relaxed);
+            }
+            return result;
+        }
+
+        // upper limit in nanoseconds of the bucket holding the fraction of calls; worst if
+        // the fraction falls in the last bucket
+        uint32_t percentile(double fraction) const {
+            uint32_t target = (uint32_t) std::ceil(this->count() * fraction);
+            uint32_t sum = 0;
+            for (unsigned bucket = 0; bucket < BUCKET_COUNT - 1; ++bucket) {
+                sum += buckets[bucket].load(std::memory_order_relaxed);
+                if (target && sum >= target) {
+                    return FIRST_BUCKET_NS << bucket;
+                }
+            }
+            return worst.load(std::memory_order_relaxed);
+        }
+    };
+
+    array<Histogram, PHASE_COUNT> phases;
+    std::atomic<uint64_t> idleSamples { 0 };    // samples skipped until next event was due
+    std::atomic<uint64_t> blockPlays { 0 };     // skipped samples that played scheduled events
+    std::atomic<uint64_t> events { 0 };         // timeline events walked starting notes
+    std::atomic<uint64_t> notesStarted { 0 };
+    std::atomic<uint32_t> requestsMax { 0 };    // most requests drained by one call
+    std::atomic<uint32_t> notifyMax { 0 };      // most records waiting for the ui thread
+    std::atomic<bool> clearRequested { false }; // set by ui thread; audio thread clears
+    // audio thread only
+    std::chrono::steady_clock::time_point first;
+    std::chrono::steady_clock::time_point mark;
+
+    static const char* PhaseName(Phase phase) {
+        switch (phase) {
+            case requests: return "requests";
+            case advance: return "advance";
+            case notes: return "notes";
+            case expander: return "expander";
+            case total: return "total";
+            default:
+                _schmickled();
+        }
+        return "";
+    }
+
+    template<typename T>
+    static void Bump(std::atomic<T>& counter, T by = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    template<typename T>
+    static void Most(std::atomic<T>& counter, T value) {
+        if (value > counter.load(std::memory_order_relaxed)) {
+            counter.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    // called by audio thread when a sample does work
+    void begin() {
+        if (clearRequested.load(std::memory_order_acquire)) {
+            for (auto& phase : phases) {
+                phase.clear();
+            }
+            idleSamples.store(0, std::memory_order_relaxed);
+            blockPlays.store(0, std::memory_order_relaxed);
+            events.store(0, std::memory_order_relaxed);
+            notesStarted.store(0, std::memory_order_relaxed);
+            requestsMax.store(0, std::memory_order_relaxed);
+            notifyMax.store(0, std::memory_order_relaxed);
+            clearRequested.store(false, std::memory_order_release);
+        }
+        first = mark = std::chrono::steady_clock::now();
+    }
+
+    // called by audio thread as each phase finishes; the last phase finishes the sample
+    void end(Phase phase) {
+        auto now = std::chrono::steady_clock::now();
+        phases[phase].add(Nanoseconds(now - mark));
+        mark = now;
+        if (expander == phase) {
+            phases[total].add(Nanoseconds(now - first));
+        }
+    }
+
+    static uint32_t Nanoseconds(std::chrono::steady_clock::duration elapsed) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        return (uint32_t) std::min<decltype(ns)>(ns, UINT32_MAX);
+    }
+
+    // one line per phase for the context menu, as: median, 99th percentile, and worst
+    std::string summary(Phase phase) const {
+        const Histogram& h = phases[phase];
+        char buffer[80];
+        snprintf(buffer, sizeof(buffer), "%-9s p50 %6.2f p99 %6.2f max %7.2f us",
+                PhaseName(phase), h.percentile(.5) / 1000., h.percentile(.99) / 1000.,
+                h.worst.load(std::memory_order_relaxed) / 1000.);
+        return buffer;
+    }
+
+    json_t* toJson() const;
+};
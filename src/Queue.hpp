@@ -0,0 +1,74 @@
+#pragma once
+
+#include "SchmickleWorks.hpp"
+#include <atomic>
+
+// wait-free queue passing records between exactly one writing and one reading thread
+// writer fills the slot at tail, then publishes it by advancing tail (release);
+// reader consumes the slot at head, then frees it by advancing head (release)
+// indices run freely and wrap by mask, so capacity must be a power of two
+// a full queue drops the newest record and counts it rather than block the writer
+template<typename Record, unsigned capacity>
+struct SpscQueue {
+    static_assert(capacity && !(capacity & (capacity - 1)), "capacity must be a power of two");
+    static constexpr unsigned mask = capacity - 1;
+
+    // called by reader or writer; result is stale by the time the other thread acts
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    // called by reader or writer; records published but not yet consumed
+    unsigned size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    // called by writer only; returns false if record was dropped
+    bool push(const Record& record) {
+        unsigned t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= capacity) {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[t & mask] = record;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // called by reader only; returns false if there was nothing to read
+    bool pop(Record* record) {
+        unsigned h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *record = buffer[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // called by reader only; handles records published before the call, so a writer that
+    // keeps pushing can't hold the reader in the loop; returns count of records handled
+    template<typename Handler>
+    unsigned drain(Handler handler) {
+        unsigned h = head.load(std::memory_order_relaxed);
+        const unsigned t = tail.load(std::memory_order_acquire);
+        unsigned count = t - h;
+        for (; h != t; ++h) {
+            handler(buffer[h & mask]);
+            head.store(h + 1, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // records dropped because queue was full
+    unsigned overflowCount() const {
+        return overflows.load(std::memory_order_relaxed);
+    }
+
+private:
+    array<Record, capacity> buffer;
+    // reader and writer indices on separate cache lines so threads don't contend
+    alignas(64) std::atomic<unsigned> head { 0 };
+    alignas(64) std::atomic<unsigned> tail { 0 };
+    std::atomic<unsigned> overflows { 0 };
+};
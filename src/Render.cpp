@@ -0,0 +1,169 @@
+#include "Render.hpp"
+#include "Taker.hpp"
+
+// samples processed between reads of the thread clock
+const unsigned RENDER_BLOCK = 1024;
+
+// loads midi into slot one of a scratch module, set to play from start; called by ui thread,
+// since publishing its timelines shares them with every note taker
+std::unique_ptr<NoteTaker> NoteTaker::CreateRenderer(const std::string& midiPath) {
+    std::unique_ptr<NoteTaker> nt(new NoteTaker);
+    auto& slot = nt->storage.slots[0];
+    size_t lastSlash = midiPath.rfind('/');
+    slot.directory = std::string::npos == lastSlash ? "" : midiPath.substr(0, lastSlash + 1);
+    slot.filename = std::string::npos == lastSlash ? midiPath : midiPath.substr(lastSlash + 1);
+    if (!slot.setFromMidi()) {
+        return nullptr;
+    }
+    nt->storage.slotStart = 0;
+    nt->publishStorage();
+    nt->requests.push({RequestType::setRunning, 1});
+    nt->requests.push(RequestType::resetAndPlay);
+    return nt;
+}
+
+// calls process() as fast as it will go; may be called by any thread once renderer is created
+// if trace is set, writes a row for each sample where a cv, gate, or velocity output changes
+// on a channel with notes:
+//     sample, channel, voice, cv, gate, velocity
+// the thread clock is read once a block for the total, so it includes the trace compares if
+// tracing; if timeSamples is set, it is also read around each process() call to find the
+// slowest sample, which finds spikes a block's total hides, but adds two clock reads a sample
+bool NoteTaker::render(float seconds, float sampleRate, FILE* trace, bool timeSamples,
+        RenderStats* stats,
+        const std::atomic<bool>* cancel, std::atomic<unsigned>* rendered) {
+    unsigned traced = 0;    // bit set for each channel with notes
+    for (const auto& note : storage.slots[0].n.notes) {
+        if (NOTE_ON == note.type) {
+            traced |= 1 << note.channel;
+        }
+    }
+    if (trace) {
+        fprintf(trace, "sample,channel,voice,cv,gate,velocity\n");
+    }
+    struct Last {
+        float cv = 0;
+        float gate = 0;
+        float velocity = 0;
+    };
+    array<array<Last, VOICE_COUNT>, CHANNEL_COUNT> last;
+    *stats = RenderStats();
+    ProcessArgs args;
+    args.sampleRate = sampleRate;
+    args.sampleTime = 1 / sampleRate;
+    unsigned sampleCount = (unsigned) (seconds * sampleRate);
+    unsigned sample = 0;
+    while (sample < sampleCount) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) {
+            return false;
+        }
+        unsigned blockEnd = std::min(sampleCount, sample + RENDER_BLOCK);
+        double start = system::getThreadTime();
+        for (; sample < blockEnd; ++sample) {
+            if (timeSamples) {
+                double before = system::getThreadTime();
+                this->process(args);
+                stats->worstTime = std::max(stats->worstTime, system::getThreadTime() - before);
+            } else {
+                this->process(args);
+            }
+            if (!trace) {
+                continue;
+            }
+            for (unsigned bits = traced; bits; bits &= bits - 1) {
+                unsigned chan = __builtin_ctz(bits);
+                const auto& c = channels[chan];
+                for (unsigned voice = 0; voice < c.voiceCount; ++voice) {
+                    Last now;
+                    // note taker's own channels play through its outputs; the rest, kept
+                    // for super 8s, are read from their lanes
+                    now.cv = chan < CV_OUTPUTS ?
+                            outputs[CV1_OUTPUT + chan].getVoltage(voice) : c.cvs[voice];
+                    now.gate = chan < CV_OUTPUTS ?
+                            outputs[GATE1_OUTPUT + chan].getVoltage(voice) : c.gates[voice];
+                    now.velocity = c.velocities[voice];
+                    Last& prior = last[chan][voice];
+                    if (prior.cv == now.cv && prior.gate == now.gate
+                            && prior.velocity == now.velocity) {
+                        continue;
+                    }
+                    stats->events += prior.gate != now.gate;
+                    prior = now;
+                    fprintf(trace, "%u,%u,%u,%g,%g,%g\n", sample, chan, voice,
+                            now.cv, now.gate, now.velocity);
+                }
+            }
+        }
+        stats->totalTime += system::getThreadTime() - start;
+        if (rendered) {
+            rendered->store(sample, std::memory_order_relaxed);
+        }
+    }
+    stats->samples = sampleCount;
+    stats->renderedTime = sampleCount * (double) args.sampleTime;
+    return true;
+}
+
+OfflineRender::~OfflineRender() {
+    this->cancel();
+}
+
+// called by ui thread; worker notices within a block
+void OfflineRender::cancel() {
+    if (!worker.joinable()) {
+        return;
+    }
+    cancelled.store(true, std::memory_order_relaxed);
+    worker.join();
+    state.store(State::idle, std::memory_order_relaxed);
+    taker.reset();
+    if (debugVerbose) DEBUG("%s %s", __func__, midiPath.c_str());
+}
+
+// called by ui thread each step; true once, when worker has stopped
+bool OfflineRender::finished() {
+    if (!worker.joinable() || State::running == state.load(std::memory_order_acquire)) {
+        return false;
+    }
+    worker.join();
+    if (State::done == state.load(std::memory_order_relaxed)) {
+        DEBUG("render %s to %s: %s", midiPath.c_str(), tracePath.c_str(),
+                stats.debugString().c_str());
+    } else {
+        DEBUG("render %s failed", midiPath.c_str());
+    }
+    state.store(State::idle, std::memory_order_relaxed);
+    taker.reset();
+    return true;
+}
+
+// called by ui thread; loads file, then renders it on worker
+bool OfflineRender::start(const std::string& midi, const std::string& trace) {
+    this->cancel();
+    midiPath = midi;
+    tracePath = trace;
+    taker = NoteTaker::CreateRenderer(midiPath);
+    if (!taker) {
+        DEBUG("render %s failed to load", midiPath.c_str());
+        return false;
+    }
+    sampleCount = (unsigned) (seconds * sampleRate);
+    rendered.store(0, std::memory_order_relaxed);
+    cancelled.store(false, std::memory_order_relaxed);
+    state.store(State::running, std::memory_order_relaxed);
+    // menu may change settings while worker runs, so it gets its own copies
+    float length = seconds;
+    float rate = sampleRate;
+    bool timed = timeSamples;
+    worker = std::thread([this, length, rate, timed]() {
+        FILE* file = fopen(tracePath.c_str(), "w");
+        bool ok = file && taker->render(length, rate, file, timed, &stats, &cancelled, &rendered);
+        if (file) {
+            fclose(file);
+        } else {
+            DEBUG("%s fopen failed", tracePath.c_str());
+        }
+        state.store(ok ? State::done : State::failed, std::memory_order_release);
+    });
+    return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "SchmickleWorks.hpp"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+struct NoteTaker;
+
+// results of rendering a score offline, without rack's audio thread
+struct RenderStats {
+    unsigned samples = 0;
+    unsigned events = 0;        // gate changes across all outputs
+    double renderedTime = 0;    // seconds of output rendered
+    double totalTime = 0;       // thread seconds spent rendering
+    double worstTime = 0;       // thread seconds of slowest process() call; zero if not timed
+
+    std::string debugString() const;
+};
+
+// renders a midi file on a worker thread, so rack keeps running while millions of samples
+// are processed; the ui thread loads the file and starts it, and reports stats once done
+struct OfflineRender {
+    enum class State {
+        idle,
+        running,
+        done,
+        failed,
+    };
+
+    std::unique_ptr<NoteTaker> taker;   // scratch module; used only by worker while running
+    std::thread worker;
+    std::atomic<State> state { State::idle };
+    std::atomic<bool> cancelled { false };
+    std::atomic<unsigned> rendered { 0 };   // samples processed so far
+    RenderStats stats;
+    std::string midiPath;
+    std::string tracePath;
+    float seconds = 60;                 // length to render; set from the context menu
+    float sampleRate = 48000;
+    bool timeSamples = false;           // if set, reads thread clock around each process() call
+    unsigned sampleCount = 0;
+
+    ~OfflineRender();
+
+    bool busy() const {
+        return worker.joinable();
+    }
+
+    float fraction() const {
+        return sampleCount ? (float) rendered.load(std::memory_order_relaxed) / sampleCount : 0;
+    }
+
+    void cancel();
+    bool finished();
+    bool start(const std::string& midi, const std::string& trace);
+};
@@ -4,6 +4,7 @@
 #include "settings.hpp"
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <float.h>
 #include <functional>
 #include <limits.h>
@@ -80,6 +81,10 @@ extern int midiQuantizer;
         random,
         expected,
         encode,
+        makeMidi,
+        timeline,
+        mergeTracks,
+        shareNotes,
     };
 
     void UnitTest(struct NoteTakerWidget* , TestType );
@@ -121,13 +126,42 @@ extern int midiQuantizer;
 #define DEBUG_VOICE_COUNT 01
 #define DEBUG_WHEEL 0
 
-struct Super8Data {
-    float exCv[4][16] = {};
-    float exGate[4][16] = {};
-    float exVelocity[8][16] = {};
-    unsigned exChannels[8] = {};
+// voices of every channel, as sent to expanders
+struct alignas(64) ExpanderBlock {
+    float cv[CHANNEL_COUNT][VOICE_COUNT] = {};
+    float gate[CHANNEL_COUNT][VOICE_COUNT] = {};
+    float velocity[CHANNEL_COUNT][VOICE_COUNT] = {};
+    unsigned voiceCounts[CHANNEL_COUNT] = {};
+    unsigned generation = 0;    // incremented each time block is published
+    unsigned dirty = 0;         // bit set for each channel changed since prior generation
 };
 
+// owned by note taker; every super 8 chained to its right reads the published block in place
+// rather than each hop copying it into the next expander's message
+// note taker writes the other block, then publishes it; since expanders may run on other
+// engine threads in the same sample, the block being read is never the one being written
+struct ExpanderBus {
+    array<ExpanderBlock, 2> blocks;
+    std::atomic<unsigned> published { 0 };  // index of block expanders read
+
+    const ExpanderBlock& read() const {
+        return blocks[published.load(std::memory_order_acquire)];
+    }
+
+    // writer only
+    ExpanderBlock& write() {
+        return blocks[published.load(std::memory_order_relaxed) ^ 1];
+    }
+
+    void publish() {
+        published.store(published.load(std::memory_order_relaxed) ^ 1,
+                std::memory_order_release);
+    }
+};
+
+// bus of note taker at the left end of a chain of super 8s, or nullptr if module isn't one
+extern const ExpanderBus* NoteTakerExpanderBus(const Module* );
+
 template<class TWidget>
 struct WidgetToolTip : ParamQuantity {
     TWidget* widget = nullptr;
@@ -2,6 +2,12 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unordered_map>
+#if !defined ARCH_WIN
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include "MakeMidi.hpp"
 #include "ParseMidi.hpp"
 #include "Storage.hpp"
@@ -24,6 +30,52 @@ void NoteTakerSlot::UnitTest() {
     SCHMICKLE(!memcmp(&encodeJunk.front(), &encoded.front(), encodeJunk.size()));
 }
 
+vector<std::shared_ptr<const void>> SlotArray::retired;
+
+// timelines built by every note taker, keyed by hash of the notes and channels built from;
+// a patch full of note takers holding the same scores compiles and stores each one once,
+// and a slot gets a timeline of its own only when its notes are edited
+// read and written only by the ui thread; entries expire once no slot or player holds them
+static std::unordered_multimap<size_t, std::weak_ptr<const PlayTimeline>> sharedTimelines;
+
+static std::shared_ptr<const PlayTimeline> FindSharedTimeline(const PlayKeys& keys,
+        const Notes& n, const array<NoteTakerChannel, CHANNEL_COUNT>& channels) {
+    auto range = sharedTimelines.equal_range(keys.hash);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        auto candidate = iter->second.lock();
+        if (candidate && candidate->builtFrom(keys, n.ppq, channels)) {
+            return candidate;
+        }
+    }
+    return nullptr;
+}
+
+static void ShareTimeline(size_t hash, const std::shared_ptr<const PlayTimeline>& built) {
+    for (auto iter = sharedTimelines.begin(); iter != sharedTimelines.end(); ) {
+        iter = iter->second.expired() ? sharedTimelines.erase(iter) : std::next(iter);
+    }
+    sharedTimelines.emplace(hash, built);
+}
+
+// called by ui thread after notes change; audio thread picks up new timeline on next request
+// returns the replaced timeline, which the audio thread may still be playing, or nullptr if
+// the notes still compile to the timeline the slot has
+std::shared_ptr<const PlayTimeline> NoteTakerSlot::buildTimeline() {
+    auto prior = std::atomic_load(&timeline);
+    PlayKeys keys(n, channels);
+    auto shared = FindSharedTimeline(keys, n, channels);
+    if (!shared) {
+        auto built = std::make_shared<PlayTimeline>();
+        built->build(n, keys, channels, prior.get());
+        shared = built;
+        ShareTimeline(keys.hash, shared);
+    }
+    if (shared == prior) {
+        return nullptr;
+    }
+    return std::atomic_exchange(&timeline, shared);
+}
+
 void NoteTakerSlot::Decode(const vector<char>& encoded, vector<uint8_t>* midi) {
     midi->clear();
     midi->reserve(encoded.size() * 3 / 4);
@@ -95,13 +147,8 @@ std::string NoteTakerSlot::debugString(unsigned index) const {
           + (invalid ? "true" : "false");
 }
 
+// streams midi to the file a chunk at a time, rather than building the whole file first
 void NoteTakerSlot::writeToMidi() const {
-    vector<uint8_t> midi;
-    NoteTakerMakeMidi maker;
-    maker.createFromNotes(*this, midi);
-    if (midi.empty()) {
-        return;
-    }
     std::string userDir = SlotArray::UserDirectory();
     if (!system::isDirectory(userDir)) {
         system::createDirectory(userDir);
@@ -113,10 +160,17 @@ void NoteTakerSlot::writeToMidi() const {
         DEBUG("remove %s err %d", destPath.c_str(), err);
     }
     FILE* dest = fopen(destPath.c_str(), "wb");
-    size_t wrote = fwrite((const char*) &midi.front(), 1, midi.size(), dest);
+    if (!dest) {
+        DEBUG("%s could not open %s", __func__, destPath.c_str());
+        return;
+    }
+    NoteTakerMakeMidi maker;
+    size_t wrote = maker.writeFromNotes(*this, dest);
     fclose(dest);
-    if (debugVerbose) {
-        DEBUG("%s wrote %u requested to write %d", destPath.c_str(), wrote, midi.size());
+    if (!wrote) {
+        DEBUG("%s failed to write %s", __func__, destPath.c_str());
+    } else if (debugVerbose) {
+        DEBUG("%s wrote %u", destPath.c_str(), (unsigned) wrote);
     }
 }
 
@@ -125,7 +179,57 @@ static off_t fsize(const std::string& path) {
     return !stat(path.c_str(), &st) ? st.st_size : -1;
 }
 
-bool NoteTakerSlot::setFromMidi() {
+// bytes of a midi file for the parser: mapped read only where the os allows, so a large file
+// is parsed in place rather than copied first; read into memory on windows, or if mapping fails
+struct MidiFile {
+    vector<uint8_t> buffer;
+    MidiSpan span;
+#if !defined ARCH_WIN
+    void* mapped = MAP_FAILED;
+
+    ~MidiFile() {
+        if (MAP_FAILED != mapped) {
+            munmap(mapped, span.size());
+        }
+    }
+#endif
+
+    bool load(const std::string& path, off_t fileSize) {
+#if !defined ARCH_WIN
+        if (fileSize > 0) {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd >= 0) {
+                mapped = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                ::close(fd);    // mapping outlives descriptor
+                if (MAP_FAILED != mapped) {
+                    madvise(mapped, fileSize, MADV_SEQUENTIAL);
+                    span = MidiSpan((const uint8_t*) mapped, fileSize);
+                    return true;
+                }
+                DEBUG("%s mmap failed; reading instead", path.c_str());
+            }
+        }
+#endif
+        FILE* source = fopen(path.c_str(), "rb");
+        if (!source) {
+            DEBUG("%s fopen failed", path.c_str());
+            return false;
+        }
+        buffer.resize(fileSize);
+        size_t bytesRead = fread(buffer.data(), 1, fileSize, source);
+        fclose(source);
+        if (bytesRead != (size_t) fileSize) {
+            DEBUG("%s did not read all of file: requested %d read %d", path.c_str(),
+                    bytesRead, fileSize);
+            return false;
+        }
+        span = MidiSpan(buffer);
+        return true;
+    }
+};
+
+bool NoteTakerSlot::setFromMidi(ParseProgress* progress,
+        array<NoteTakerChannel, CHANNEL_COUNT>* channelInfo, bool quiet) {
     std::string sourcePath = directory + filename;
     if (!system::isFile(sourcePath)) {
         DEBUG("%s file can't be read", sourcePath.c_str());
@@ -136,24 +240,23 @@ bool NoteTakerSlot::setFromMidi() {
         DEBUG("%s fsize failed", sourcePath.c_str());
         return false;
     }
-    FILE* source = fopen(sourcePath.c_str(), "rb");
-    if (!source) {
-        DEBUG("%s fopen failed", sourcePath.c_str());
+    MidiFile midi;
+    if (!midi.load(sourcePath, fileSize)) {
         return false;
     }
-    vector<uint8_t> midi;
-    midi.resize(fileSize);
-    size_t bytesRead = fread(&midi.front(), 1, fileSize, source);
-    fclose(source);
-    if (bytesRead != (size_t) fileSize) {
-        DEBUG("%s did not read all of file: requested %d read %d", sourcePath.c_str(),
-                bytesRead, fileSize);
-        return false;
+    if (progress) {
+        progress->reset(midi.span.size());
     }
-    NoteTakerParseMidi parser(midi, &n.notes, &n.ppq, &channels);
+    // may run on a worker thread, so parsed notes are not shared here
+    vector<DisplayNote> parsed;
+    NoteTakerParseMidi parser(midi.span, &parsed, &n.ppq, &channels);
+    parser.progress = progress;
+    parser.channelInfo = channelInfo;
+    parser.quiet = quiet;
     if (!parser.parseMidi()) {
-        DEBUG("failed to parseMidi %s %s", directory.c_str(), filename.c_str());
+        if (!quiet) DEBUG("failed to parseMidi %s %s", directory.c_str(), filename.c_str());
         return false;
     }
+    n.notes.assign(std::move(parsed));
     return true;
 }
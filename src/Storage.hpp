@@ -3,6 +3,7 @@
 #include "Cache.hpp"
 #include "Channel.hpp"
 #include "Notes.hpp"
+#include "Timeline.hpp"
 
 // which cache elements are invalidated; whether to play the current selection
 enum class Inval {
@@ -16,6 +17,8 @@ enum class Inval {
 
 extern std::string InvalDebugStr(Inval );
 
+struct ParseProgress;
+
 struct SlotPlay {
     // switch slots on next ...
     enum class Stage {
@@ -32,6 +35,14 @@ struct SlotPlay {
     unsigned repeat = INT_MAX;
     Stage stage = Stage::song;
 
+    bool operator==(const SlotPlay& s) const {
+        return index == s.index && repeat == s.repeat && stage == s.stage;
+    }
+
+    bool operator!=(const SlotPlay& s) const {
+        return !(*this == s);
+    }
+
     void fromJson(json_t* root) {
         INT_FROM_JSON(index);
         INT_FROM_JSON(repeat);
@@ -52,17 +63,20 @@ struct SlotPlay {
 struct NoteTakerSlot {
     Notes n;
     DisplayCache cache;
+    std::shared_ptr<const PlayTimeline> timeline;  // swapped atomically; read by audio thread
     array<NoteTakerChannel, CHANNEL_COUNT> channels;
     std::string directory;
     std::string filename;
     bool invalid = true;
 
+    std::shared_ptr<const PlayTimeline> buildTimeline();
     static void Decode(const vector<char>& encoded, vector<uint8_t>* midi);
     static void EncodeTriplet(const uint8_t trips[3], vector<char>* encoded);
     static void Encode(const vector<uint8_t>& midi, vector<char>* encoded);
     std::string debugString(unsigned index) const;
     void fromJson(json_t* root);
-    bool setFromMidi();
+    bool setFromMidi(ParseProgress* progress = nullptr,
+            array<NoteTakerChannel, CHANNEL_COUNT>* channelInfo = nullptr, bool quiet = false);
     json_t* toJson() const;
     static void UnitTest();
     void writeToMidi() const;
@@ -71,6 +85,10 @@ struct NoteTakerSlot {
 struct SlotArray {
     array<NoteTakerSlot, SLOT_COUNT> slots;
     vector<SlotPlay> playback;
+    std::shared_ptr<const vector<SlotPlay>> published;  // swapped atomically; read by audio thread
+    // replaced timelines and playback, held until the audio thread lets go so it never frees one
+    // shared by every note taker, since slots in several may hold the same timeline
+    static vector<std::shared_ptr<const void>> retired;
     unsigned slotStart = 0; // current selection in playback vector
     unsigned slotEnd = 1;
     bool saveZero = false;   // set if single was at left-most position
@@ -88,6 +106,30 @@ struct SlotArray {
         return slots[slotStart];
     }
 
+    void buildTimeline() {
+        this->buildTimeline(slotStart);
+    }
+
+    void buildTimeline(unsigned index) {
+        auto old = slots[index].buildTimeline();
+        if (old) {
+            this->retire(std::move(old));
+        }
+    }
+
+    // called by ui thread whenever playback may have changed
+    void publishPlayback() {
+        auto current = std::atomic_load(&published);
+        if (current && *current == playback) {
+            return;
+        }
+        auto old = std::atomic_exchange(&published,
+                std::shared_ptr<const vector<SlotPlay>>(std::make_shared<vector<SlotPlay>>(playback)));
+        if (old) {
+            this->retire(std::move(old));
+        }
+    }
+
     static void FromJson(json_t* root, vector<SlotPlay>* playback);
     void fromJson(json_t* root);
 
@@ -109,6 +151,23 @@ struct SlotArray {
         playback.erase(playback.begin() + start, playback.begin() + end);
     }
       
+    // reclaims first, so retired stays bounded even if no widget steps, as in headless rack
+    void retire(std::shared_ptr<const void> old) {
+        this->reclaim();
+        if (retired.end() == std::find(retired.begin(), retired.end(), old)) {
+            retired.push_back(std::move(old));
+        }
+    }
+
+    // called by ui thread when publishing, and each widget step; a timeline referenced only
+    // here is no longer reachable by audio
+    void reclaim() {
+        retired.erase(std::remove_if(retired.begin(), retired.end(),
+                [](const std::shared_ptr<const void>& t) {
+                    return 1 == t.use_count();
+                }), retired.end());
+    }
+
     unsigned size() const { return slots.size(); }
     json_t* toJson() const;
     static std::string UserDirectory() { return asset::user("Schmickleworks/"); }
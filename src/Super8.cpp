@@ -34,13 +34,11 @@ struct Super8 : Module {
 		NUM_LIGHTS
 	};
 
-	Super8Data producer;
-	Super8Data consumer;
+    unsigned generation = 0;    // of last block applied to outputs
+    unsigned chain = INT_MAX;   // super 8s between this and note taker when last applied
 
 	Super8() {
 		config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-        leftExpander.producerMessage = &producer;
-        leftExpander.consumerMessage = &consumer;
 	}
     
     void dataFromJson(json_t* root) override {
@@ -55,34 +53,74 @@ struct Super8 : Module {
     json_t* dataToJson() override {
         json_t* root = json_object();
         json_t* voices = json_array();
-        for (unsigned chan = 0; chan < EXPANSION_OUTPUTS - CV_OUTPUTS; ++chan) {
+        for (unsigned chan = 0; chan < SUPER8_CV_OUTPUTS; ++chan) {
             json_array_append_new(voices, json_integer(outputs[CV5_OUTPUT + chan].getChannels()));
         }
         json_object_set_new(root, "voiceCounts", voices);
         return root;
     }
 
+    // voices are written four at a time; lanes past voice count are ignored by cables
+    // super 8s may be chained to the right of note taker; the one at chain index n plays cv
+    // and gate for channels 5 + 4n to 8 + 4n, and velocity for channels 1 + 8n to 8 + 8n
 	void process(const ProcessArgs& args) override {
-		if (leftExpander.module && leftExpander.module->model == modelNoteTaker) {
-			Super8Data* message = (Super8Data*) leftExpander.consumerMessage;
-			for (unsigned index = 0; index < 4; index++) {
-                unsigned voiceCount = message->exChannels[CV_OUTPUTS + index];
-                outputs[CV5_OUTPUT + index].setChannels(voiceCount);
-                outputs[GATE5_OUTPUT + index].setChannels(voiceCount);
-                for (unsigned voice = 0; voice < voiceCount; ++voice) {
-                    outputs[CV5_OUTPUT + index].setVoltage(message->exCv[index][voice], voice);
-				    outputs[GATE5_OUTPUT + index].setVoltage(message->exGate[index][voice], voice);
-                }
-			}
-			for (unsigned index = 0; index < 8; index++) {
-                unsigned voiceCount = message->exChannels[index];
-                outputs[VELOCITY1_OUTPUT + index].setChannels(voiceCount);
-                for (unsigned voice = 0; voice < voiceCount; ++voice) {
-				    outputs[VELOCITY1_OUTPUT + index].setVoltage(message->exVelocity[index][voice],
-                            voice);
-                }
+        const ExpanderBus* bus = nullptr;
+        unsigned index = 0;
+        for (const Module* left = leftExpander.module; left; left = left->leftExpander.module) {
+            if (modelSuper8 != left->model) {
+                bus = NoteTakerExpanderBus(left);
+                break;
             }
-		}
+            if (++index >= SUPER8_CHAIN_MAX) {
+                break;
+            }
+        }
+        if (!bus) {
+            chain = INT_MAX;
+            return;
+        }
+        const ExpanderBlock& block = bus->read();
+        if (block.generation == generation && index == chain) {
+            return;     // note taker published nothing new; outputs hold their values
+        }
+        unsigned cvFirst = CV_OUTPUTS + SUPER8_CV_OUTPUTS * index;
+        unsigned velocityFirst = SUPER8_VELOCITY_OUTPUTS * index;
+        unsigned cvChannels = ((1 << SUPER8_CV_OUTPUTS) - 1) << cvFirst;
+        unsigned velocityChannels = velocityFirst < CHANNEL_COUNT ?
+                ((1 << SUPER8_VELOCITY_OUTPUTS) - 1) << velocityFirst : 0;
+        // if a block was missed or chain changed, every channel may be out of date
+        unsigned dirty = block.generation == generation + 1 && index == chain ? block.dirty
+                : ALL_CHANNELS;
+        generation = block.generation;
+        chain = index;
+        for (unsigned bits = dirty & cvChannels; bits; bits &= bits - 1) {
+            unsigned chan = __builtin_ctz(bits);
+            unsigned out = chan - cvFirst;
+            unsigned voiceCount = block.voiceCounts[chan];
+            outputs[CV5_OUTPUT + out].setChannels(voiceCount);
+            outputs[GATE5_OUTPUT + out].setChannels(voiceCount);
+            for (unsigned voice = 0; voice < voiceCount; voice += 4) {
+                outputs[CV5_OUTPUT + out].setVoltageSimd(
+                        simd::float_4::load(&block.cv[chan][voice]), voice);
+                outputs[GATE5_OUTPUT + out].setVoltageSimd(
+                        simd::float_4::load(&block.gate[chan][voice]), voice);
+            }
+        }
+        if (!velocityChannels) {
+            for (unsigned out = 0; out < SUPER8_VELOCITY_OUTPUTS; ++out) {
+                outputs[VELOCITY1_OUTPUT + out].setChannels(0);
+            }
+        }
+        for (unsigned bits = dirty & velocityChannels; bits; bits &= bits - 1) {
+            unsigned chan = __builtin_ctz(bits);
+            unsigned out = chan - velocityFirst;
+            unsigned voiceCount = block.voiceCounts[chan];
+            outputs[VELOCITY1_OUTPUT + out].setChannels(voiceCount);
+            for (unsigned voice = 0; voice < voiceCount; voice += 4) {
+                outputs[VELOCITY1_OUTPUT + out].setVoltageSimd(
+                        simd::float_4::load(&block.velocity[chan][voice]), voice);
+            }
+        }
 	}
 };
 
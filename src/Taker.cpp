@@ -6,17 +6,58 @@
 #include "Wheel.hpp"
 #include "Widget.hpp"
 
-// to do : to run headless, allow mainWidget and ntw() to be nullptr?
-
+// plays without a widget: params are configured here, and slots are saved with module data
 NoteTaker::NoteTaker() {
     this->config(NUM_PARAMS, NUM_INPUTS, NUM_OUTPUTS, NUM_LIGHTS);
-    requests.reader = &requests.buffer.front();
-    requests.writer = &requests.buffer.front();
+    this->configParam<RunButtonToolTip>(RUN_BUTTON, 0, 1, 0, "Play");
+    this->configParam<SelectButtonToolTip>(EXTEND_BUTTON, 0, 2, 0, "Notes");
+    this->configParam<InsertButtonToolTip>(INSERT_BUTTON, 0, 1, 0, "Insert");
+    this->configParam<CutButtonToolTip>(CUT_BUTTON, 0, 1, 0, "Cut");
+    this->configParam<RestButtonToolTip>(REST_BUTTON, 0, 1, 0, "Insert");
+    this->configParam<PartButtonToolTip>(PART_BUTTON, 0, 1, 0, "Part");
+    this->configParam<FileButtonToolTip>(FILE_BUTTON, 0, 1, 0, "Load");
+    this->configParam<SustainButtonToolTip>(SUSTAIN_BUTTON, 0, 1, 0, "Edit");
+    this->configParam<TimeButtonToolTip>(TIME_BUTTON, 0, 1, 0, "Insert");
+    this->configParam<KeyButtonToolTip>(KEY_BUTTON, 0, 1, 0, "Insert");
+    this->configParam<TieButtonToolTip>(TIE_BUTTON, 0, 1, 0, "Add");
+    this->configParam<SlotButtonToolTip>(SLOT_BUTTON, 0, 1, 0, "Edit");
+    this->configParam<TempoButtonToolTip>(TEMPO_BUTTON, 0, 1, 0, "Insert");
+    this->configParam<HorizontalWheelToolTip>(HORIZONTAL_WHEEL, 0, 1, 0, "Time Wheel");
+    this->configParam<VerticalWheelToolTip>(VERTICAL_WHEEL, 0, 1, 0, "Pitch Wheel");
+    // shared by all instances so that audio thread never frees it when slot is loaded
+    static const std::shared_ptr<const PlayTimeline> empty = [] {
+        auto built = std::make_shared<PlayTimeline>();
+        built->build(Notes(), array<NoteTakerChannel, CHANNEL_COUNT>());
+        return built;
+    }();
+    timeline = empty;
+    for (unsigned index = 0; index < SLOT_COUNT; ++index) {
+        storage.buildTimeline(index);
+    }
+    storage.publishPlayback();
+    playback = storage.published;
 }
 
 float NoteTaker::beatsPerHalfSecond(int localTempo) const {
-    float deltaTime = (float) stdMSecsPerQuarterNote / localTempo;
-    if (mainWidget->runningWithButtonsOff()) {
+    return (float) stdMSecsPerQuarterNote / localTempo * this->tempoRatio();
+}
+
+// score seconds advanced per real second; one unless tempo wheel or external clock
+// speeds or slows play; score tempo changes are applied by the timeline's tempo map
+double NoteTaker::playRate() const {
+    if (this->followingClock()) {
+        if (!clockFollower.tickRate) {
+            return 1;   // until clock period is learned, play at score tempo
+        }
+        const PlayTimeline& t = *timeline;
+        return clockFollower.tickRate * t.secondsPerTick(t.secondsToMidi(elapsedSeconds));
+    }
+    return this->tempoRatio();
+}
+
+float NoteTaker::tempoRatio() const {
+    float ratio = 1;
+    if (this->isRunning() && !this->menuButtonOn()) {
         // to do : decide how external clock works
         // external clock input could work in one of three modes:
         // 1/2) input voltage overrides / multiplies wheel value
@@ -24,36 +65,49 @@ float NoteTaker::beatsPerHalfSecond(int localTempo) const {
         // for 3), second step determines bphs -- tempo change always lags 1 beat
         // playback continues for one beat after clock stops
         static float lastRatio = 0;
-        const auto horizontalWheel = ntw()->horizontalWheel;
-        float tempoRatio = this->wheelToTempo(horizontalWheel->getValue());
+        float tempoRatio = this->wheelToTempo(params[HORIZONTAL_WHEEL].getValue());
         if (lastRatio != tempoRatio) {
-            ntw()->redraw();    // ok to call at any time
+            if (mainWidget) {
+                mainWidget->redraw();    // ok to call at any time
+            }
             lastRatio = tempoRatio;
         }
-        if ((deltaTime < 0 || tempoRatio < 0) && debugVerbose) DEBUG("local %d delta %g ratio %g", localTempo, deltaTime, tempoRatio);
-        deltaTime *= tempoRatio;
+        if (tempoRatio < 0 && debugVerbose) DEBUG("ratio %g", tempoRatio);
+        ratio = tempoRatio;
     }
-    return deltaTime;
+    return ratio;
 }
 
-// if clockCycle is 120 bpm, external clock tempo equals internal tempo
-int NoteTaker::externalTempo() {
-    if (inputs[CLOCK_INPUT].isConnected()) {
-        if (clockCycle) {
-            // upward edge, advance clock
-            if (!this->isRunning()) {
-                ntw()->reqs.push(ReqType::runButtonActivate);
-            } else {
-                externalClockTempo = (int) (tempo * 2 / clockCycle);
-            }
+// on external clock edge, starts play if stopped; otherwise locks play phase to the edge
+void NoteTaker::followClock() {
+    if (!this->isRunning()) {
+        if (mainWidget) {
+            reqs.push(ReqType::runButtonActivate);  // widget lights button, then plays
+            return;
         }
-        return externalClockTempo;
+        running = true;
+        this->resetRun();
+        this->setPlayStart();
+        this->playSelection();
+    }
+    clockFollower.edge(realSeconds, timeline->secondsToMidi(elapsedSeconds), timeline->ppq);
+}
+
+// called by ui thread after slots are read from json; compiles every slot for playback
+void NoteTaker::publishStorage() {
+    for (unsigned index = 0; index < SLOT_COUNT; ++index) {
+        storage.buildTimeline(index);
     }
-    return tempo;
+    storage.publishPlayback();
+    requests.push({RequestType::setSlotStart, storage.slotStart});
+    requests.push({RequestType::invalidateAndPlay, (unsigned) Inval::load});
 }
 
-bool NoteTaker::isRunning() const {
-    return ntw()->runButton->ledOn();
+// matches NoteTakerWidget::menuButtonOn(); led buttons keep their state in their params
+bool NoteTaker::menuButtonOn() const {
+    return params[FILE_BUTTON].getValue() || params[PART_BUTTON].getValue()
+            || params[SLOT_BUTTON].getValue() || params[SUSTAIN_BUTTON].getValue()
+            || params[TIE_BUTTON].getValue();
 }
 
 // don't change other threads data here (display)
@@ -69,97 +123,188 @@ void NoteTaker::invalidateAndPlay(Inval inval) {
     }
     if (Inval::load == inval) {
         this->resetRun();
+        this->loadTimeline();
         this->setVoiceCount();
         this->setOutputsVoiceCount();
-    } else if (Inval::cut != inval) {
+    } else if (Inval::cut == inval || this->isRunning()) {
+        this->loadTimeline();   // while running, edits take effect without restarting
+        this->setVoiceCount();
+        this->setOutputsVoiceCount();
+    } else {
         this->setPlayStart();   // make sure notes are set up in caller before calling set start
         this->playSelection();
     }
 }
 
-// to do : document why a non-const version is required
-Notes& NoteTaker::n() {
-    return ntw()->storage.current().n;
+// swaps in playback order published by ui thread
+void NoteTaker::loadPlayback() {
+    auto latest = std::atomic_load(&storage.published);
+    if (latest) {
+        playback = latest;
+    }
+}
+
+// swaps in timeline built by ui thread for current slot
+// if playing, continues from the current time: notes still sounding in the new timeline keep
+// playing, others are stopped; otherwise, stops notes played from prior one
+void NoteTaker::loadTimeline() {
+    auto latest = std::atomic_load(&storage.slots[slotStart].timeline);
+    if (!latest || latest == timeline) {
+        return;
+    }
+    invalidVoiceCount = true;
+    if (!playStart) {
+        this->zeroGates();
+        timeline = latest;
+        playNext = 0;
+        return;
+    }
+    const PlayTimeline& old = *timeline;
+    const PlayTimeline& t = *latest;
+    int midiTime = old.secondsToMidiTime(elapsedSeconds);
+    // keep position in ticks; edited tempo changes move it in seconds
+    elapsedSeconds = t.midiToSeconds(old.secondsToMidi(elapsedSeconds));
+    for (unsigned chan = 0; chan < CHANNEL_COUNT; ++chan) {
+        for (unsigned index = 0; index < VOICE_COUNT; ++index) {
+            auto& voice = channels[chan].voices[index];
+            if (INT_MAX == voice.event) {
+                continue;
+            }
+            unsigned event = t.findGateOn(old.times[voice.event], chan, old.cvs[voice.event]);
+            if (INT_MAX != event && t.voices[event] == index && t.ends[event] > midiTime) {
+                voice.event = event;
+                continue;
+            }
+            voice.event = INT_MAX;
+            if (chan < CV_OUTPUTS) {
+                outputs[GATE1_OUTPUT + chan].setVoltage(0, index);
+            } else {
+                channels[chan].gates[index] = 0;
+                this->markExpander(chan);
+            }
+        }
+    }
+    timeline = latest;
+    // events starting now or earlier have been played; first unexpired event may be earlier
+    playNext = std::upper_bound(t.times.begin(), t.times.end(), midiTime) - t.times.begin();
+    playStart = std::max(1u, std::min(t.seek(midiTime), playNext));
+    if (playStart >= t.size()) {
+        playStart = 0;
+        playNext = 0;
+        this->zeroGates();
+    }
+    midiEndTime = t.selectionEnd(selectStart, selectEnd, this->isRunning());
+}
+
+// entry in playback that plays slot being played; keeps current entry if slot appears twice
+unsigned NoteTaker::playbackPosition() const {
+    const auto& p = *playback;
+    if (playPosition < p.size() && p[playPosition].index == slotStart) {
+        return playPosition;
+    }
+    for (unsigned index = 0; index < p.size(); ++index) {
+        if (p[index].index == slotStart) {
+            return index;
+        }
+    }
+    return 0;
 }
 
-const Notes& NoteTaker::n() const {
-    return ntw()->storage.current().n;
+// sets slot ending condition that eos input and slot changes wait for
+void NoteTaker::setRunningStage(SlotPlay::Stage stage) {
+    runningStage = stage;
+    eosBase = 0;
+    eosInterval = 0;
+    switch (runningStage) {
+        case SlotPlay::Stage::step:
+            break;
+        case SlotPlay::Stage::beat:     // to do : rename, really midi tick
+            eosInterval = 1;
+            break;
+        case SlotPlay::Stage::quarterNote:
+            eosInterval = timeline->ppq;
+            break;
+        case SlotPlay::Stage::bar:
+            eosInterval = timeline->ppq * 4;  // 4/4 until time signature event sets bar length
+            break;
+        case SlotPlay::Stage::song:
+            eosBase = midiEndTime;
+            break;
+        case SlotPlay::Stage::never:
+            eosBase = INT_MAX;  // eos input is ignored
+            break;
+        default:
+            _schmickled();
+    }
 }
 
 void NoteTaker::playSelection() {
-    const auto& n = this->n();
-    elapsedSeconds = MidiToSeconds(n.notes[n.selectStart].startTime, n.ppq);
-    elapsedSeconds *= (float) stdMSecsPerQuarterNote / tempo;
-    int midiTime = SecondsToMidi(elapsedSeconds, n.ppq);
-    eosInterval = 0;
-    const auto& storage = ntw()->storage;
-    bool runningWithSlots = this->isRunning() && ntw()->slotButton->ledOn();
+    const PlayTimeline& t = *timeline;
+    int startTime = selectStart < t.noteStarts.size() ? t.noteStarts[selectStart] : 0;
+    elapsedSeconds = t.midiToSeconds(startTime);
+    int midiTime = startTime;
+    bool runningWithSlots = this->isRunning() && params[SLOT_BUTTON].getValue();
     if (runningWithSlots) {
-        const auto& slotPlay = storage.playback[storage.slotStart];
-        runningStage = slotPlay.stage;
+        this->loadPlayback();
+        playPosition = this->playbackPosition();
+        const auto& slotPlay = (*playback)[playPosition];
+        this->setRunningStage(slotPlay.stage);
         repeat = slotPlay.repeat;
-        eosBase = 0;
-        switch (runningStage) {
-            case SlotPlay::Stage::step:
-                break;
-            case SlotPlay::Stage::beat:     // to do : rename, really midi tick
-                eosInterval = 1;
-                break;
-            case SlotPlay::Stage::quarterNote:
-                eosInterval = n.ppq;
-                break;
-            case SlotPlay::Stage::bar:
-                // interval set by advance play start
-                break;
-            case SlotPlay::Stage::song:
-                eosBase = midiEndTime;
-                break;
-            default:
-                _schmickled();
-        }
     } else {
-        runningStage = SlotPlay::Stage::song;
-        eosBase = midiEndTime;
+        this->setRunningStage(SlotPlay::Stage::song);
         repeat = this->isRunning() ? INT_MAX : 1;
     }
 #if DEBUG_RUN
     if (debugVerbose) DEBUG("%s playStart %d midiTime %d midiEndTime %d",
             __func__, playStart, midiTime, midiEndTime);
 #endif
+    this->seekPlayStart(midiTime);
     this->advancePlayStart(midiTime, midiEndTime);
 #if DEBUG_RUN
     if (debugVerbose) DEBUG("%s advance playStart %d", __func__, playStart);
 #endif
 }
 
-#if DEBUG_CPU_TIME
-static double worstTime = 0;
-static double lastTime = 0;
-static bool reportWorstLater = false;
-static int reported = 0;
-#endif
-
 // since this runs on a high frequency thread, avoid state except to play notes
 // to do : while !running but notes are playing, disallow edits to notes and slots 
 //         (by ignoring button presses / wheel changes)
 void NoteTaker::process(const ProcessArgs &args) {
-#if DEBUG_CPU_TIME
-    double startTime = system::getThreadTime();
-#endif
     realSeconds += args.sampleTime;
 #if RUN_UNIT_TEST
-    if (mainWidget->runUnitTest) {
+    if (mainWidget && mainWidget->runUnitTest) {
         return;
     }
 #endif
     outputs[CLOCK_OUTPUT].setVoltage(clockPulse.process(args.sampleTime) ? 10 : 0);
     outputs[EOS_OUTPUT].setVoltage(eosPulse.process(args.sampleTime) ? 10 : 0);
     bool ignoreClock = 0.001f > resetTimer.process(args.sampleTime);
-    while (!requests.empty()) {
-        RequestRecord record = requests.pop();
+    bool resetEdge = inputs[RESET_INPUT].isConnected()
+            && resetTrigger.process(inputs[RESET_INPUT].getVoltage());
+    bool clockEdge = inputs[CLOCK_INPUT].isConnected() && !ignoreClock
+            && clockTrigger.process(inputs[CLOCK_INPUT].getVoltage());
+    bool eosEdge = eosTrigger.process(inputs[EOS_INPUT].getVoltage());
+    // until the next event is due, only advance the clock; any input edge, request, or change
+    // in sample rate or tempo wheel recomputes the horizon
+    if (idleSamples && requests.empty() && !resetEdge && !clockEdge && !eosEdge
+            && args.sampleTime == idleSampleTime
+            && params[HORIZONTAL_WHEEL].getValue() == idleWheel
+            && this->transpose() == transposed) {
+        --idleSamples;
+        if (blockNext < blockCount && blockOffset >= blockOffsets[blockNext]) {
+            this->playBlockSample();
+        }
+        ++blockOffset;
+        elapsedSeconds += idleStep;
+        this->copyToExpander((bool) playStart);
+        ProcessProfile::Bump(profile.idleSamples);
+        return;
+    }
+    idleSamples = 0;
+    profile.begin();
+    unsigned drained = requests.drain([this](const RequestRecord& record) {
 #if DEBUG_REQUEST
         if (debugVerbose) {
-            DEBUG("%s pop %s", __func__, record.debugStr().c_str());
+            DEBUG("process pop %s", record.debugStr().c_str());
         }
 #endif
         switch (record.type) {
@@ -179,24 +324,51 @@ void NoteTaker::process(const ProcessArgs &args) {
                 break;
             case RequestType::resetPlayStart:
                 playStart = 0;
+                playNext = 0;
                 this->zeroGates();  // to do : don't do this so score can loop (last notes overlap first)
                 break;
+            case RequestType::setBlockSize:
+                if (ValidBlockSize(record.data)) {
+                    blockSize = record.data;
+                }
+                break;
             case RequestType::setClipboardLight:
                 this->setClipboardLight((float) record.data / 256.f);
                 break;
+            case RequestType::setClockFollower:
+                if (ClockFollower::ValidPpqn(record.data >> 8)) {
+                    clockFollower.ppqn = record.data >> 8;
+                }
+                clockFollower.smoothing = (ClockFollower::Smoothing)
+                        std::min(record.data & 0xFF, (unsigned) ClockFollower::Smoothing::heavy);
+                clockFollower.restart();
+                break;
+            case RequestType::setEditVoice:
+                editVoice = record.data;
+                break;
             case RequestType::setPlayStart:
                 this->setPlayStart();
                 break;
+            case RequestType::setRunning:
+                running = record.data;
+                break;
+            case RequestType::setSelectEnd:
+                selectEnd = record.data;
+                break;
+            case RequestType::setSelectStart:
+                selectStart = record.data;
+                break;
+            case RequestType::setSlotStart:
+                slotStart = std::min(record.data, (unsigned) SLOT_COUNT - 1);
+                break;
             default:
                 assert(0);
         }
-    }
-    auto& n = this->n();
+    });
     bool running = this->isRunning();
-    int localTempo = tempo;
     SCHMICKLE(tempo);
     if (inputs[RESET_INPUT].isConnected()) {
-        if (resetTrigger.process(inputs[RESET_INPUT].getVoltage())) {
+        if (resetEdge) {
             resetCycle = std::max(0., realSeconds - resetHighTime);
             resetHighTime = realSeconds;
             resetTimer.reset();
@@ -205,272 +377,262 @@ void NoteTaker::process(const ProcessArgs &args) {
         resetCycle = 0;
     }
     if (inputs[CLOCK_INPUT].isConnected()) {
-        if (!ignoreClock && clockTrigger.process(inputs[CLOCK_INPUT].getVoltage())) {
+        if (clockEdge) {
             clockCycle = std::max(0., realSeconds - clockHighTime);
             clockHighTime = realSeconds;
-            if (!running && ntw()->selectButton->editStart() && inputs[V_OCT_INPUT].isConnected()) {
+            bool editStart = (int) SelectButton::State::single == (int) params[EXTEND_BUTTON].getValue();
+            if (!running && editStart && inputs[V_OCT_INPUT].isConnected()) {
                 int duration;
                 if (resetCycle && clockCycle) {
                     // insert note with pitch v/oct and duration quantized by clock step
-                    duration = n.ppq * resetCycle / clockCycle;
+                    duration = timeline->ppq * resetCycle / clockCycle;
                     resetCycle = 0;
                 } else {
-                    duration = n.ppq;  // on clock step, insert quarter note with pitch set from v/oct input
+                    duration = timeline->ppq;  // on clock step, insert quarter note with pitch set from v/oct input
                 }        
                 // to do : make bias common const (if it really is one)
                 const float bias = -60.f / 12;  // MIDI middle C converted to 1 volt/octave
                 int midiNote = (int) ((inputs[V_OCT_INPUT].getVoltage() - bias) * 12);
-                unsigned insertLoc = !n.noteCount(ntw()->selectChannels) ? n.atMidiTime(0) :
-                        !n.selectStart ? mainWidget->wheelToNote(1) : n.selectEnd;
-                int startTime = n.notes[insertLoc].startTime;
-                n.insertNote(insertLoc, startTime, duration, mainWidget->unlockedChannel(), midiNote);
-                mainWidget->insertFinal(duration, insertLoc, 1);
+                // ui thread owns notes; it inserts the note and sends back the new timeline
+                this->notify({ReqType::insertNote,
+                        (unsigned) duration << 8 | (unsigned) std::max(0, std::min(127, midiNote))});
             } else {
-                localTempo = this->externalTempo();
                 if (resetCycle) {
-                    ntw()->reqs.push(ReqType::resetXAxisOffset);
+                    this->notify(ReqType::resetXAxisOffset);
                     this->resetRun();
                     this->setPlayStart();
                     this->playSelection();
                     resetCycle = 0;
                 }
+                this->followClock();
             }
         }
     } else {
         clockCycle = 0;
+        clockFollower.reset();
     }
+    ProcessProfile::Most(profile.requestsMax, drained);
+    profile.end(ProcessProfile::requests);
     bool playNotes = (bool) playStart;
     int midiTime = 0;
-    const auto& storage = ntw()->storage;
-#if DEBUG_CPU_TIME
-    double mid1 = system::getThreadTime();
-#endif
     if (playNotes) {
         // read data from display notes to determine pitch
         // note on event start changes cv and sets gate high
         // note on event duration sets gate low
-        midiTime = SecondsToMidi(elapsedSeconds, n.ppq);
-        double debugSeconds = elapsedSeconds;
-        elapsedSeconds += args.sampleTime * this->beatsPerHalfSecond(localTempo);
-        if (debugSeconds >= elapsedSeconds) {
-            DEBUG("last %g elapsed %g sample %g tempo %d beats %g",
-                    debugSeconds, elapsedSeconds, args.sampleTime, localTempo,
-                    this->beatsPerHalfSecond(localTempo));
+        midiTime = timeline->secondsToMidiTime(elapsedSeconds);
+        double sampleSeconds = elapsedSeconds;
+        elapsedSeconds += args.sampleTime * this->playRate();
+        if (sampleSeconds >= elapsedSeconds) {
+            DEBUG("last %g elapsed %g sample %g tempo %d rate %g",
+                    sampleSeconds, elapsedSeconds, args.sampleTime, tempo, this->playRate());
             _schmickled();
         }
+        if (this->followingClock()) {   // wait at next clock edge's tick until edge arrives
+            elapsedSeconds = std::max(sampleSeconds,
+                    std::min(elapsedSeconds, timeline->midiToSeconds(clockFollower.limit())));
+        }
         if (midiTime >= midiClockOut) {
-            midiClockOut += n.ppq;
+            midiClockOut += timeline->ppq;
             clockPulse.trigger();
         }
-        if (eosBase < midiTime) {   // move slot ending condition so it is always equal to or ahead
-            eosBase = midiTime;
-            if (eosInterval) {
-                eosBase += eosInterval - midiTime % eosInterval;
-            }
-        }
+        this->moveEosBase(midiTime);
         this->setOutputsVoiceCount();
 //        this->setExpiredGatesLow(midiTime);
-        bool slotOn = ntw()->slotButton->ledOn();
+        bool slotOn = params[SLOT_BUTTON].getValue();
         // if eos input is high, end song on slot ending condition
-        if (eosTrigger.process(inputs[EOS_INPUT].getVoltage()) && INT_MAX != eosBase) {
+        if (eosEdge && INT_MAX != eosBase) {
             repeat = 1;
             midiEndTime = eosBase;
             // to do : turn on slot button if off
         }
         if (!this->advancePlayStart(midiTime, midiEndTime)) {
+            // ticks play ran past the end within this sample; what plays next starts that far
+            // in, so that chained slots and looped songs stay on the grid
+            const PlayTimeline& ended = *timeline;
+            int endTime = midiTime >= midiEndTime ? midiEndTime : ended.times[playStart];
+            double past = std::max(0., ended.secondsToMidi(sampleSeconds) - endTime);
+            double step = elapsedSeconds - sampleSeconds;
             playStart = 0;
+            playNext = 0;
             if (running && slotOn) {
-                eosBase = INT_MAX;  // ignore additional triggers until next slot is staged
                 if (repeat-- <= 1) {
-                    unsigned selectStart = storage.slotStart;
-                    if (selectStart + 1 >= storage.playback.size()) {
-                        repeat = 1;
-                        ntw()->reqs.push({ReqType::stagedSlotStart, 0});
-                        running = false;
-                        // to do : turn run button off
-                    } else {
-                        const SlotPlay& slotPlay = storage.playback[selectStart + 1];
-                        repeat = slotPlay.repeat;
-                        ntw()->reqs.push({ReqType::stagedSlotStart, slotPlay.index});
-                    }
+                    this->loadPlayback();
+                    // after last slot, start over with first
+                    playPosition = playPosition + 1 < playback->size() ? playPosition + 1 : 0;
+                    const SlotPlay& slotPlay = (*playback)[playPosition];
+                    repeat = slotPlay.repeat;
+                    this->stageSlot(slotPlay.index);
                 }
             }
             if (running) {
-                ntw()->reqs.push(ReqType::resetXAxisOffset);
+                ClockFollower follower = clockFollower;
+                this->notify(ReqType::resetXAxisOffset);
                 this->resetRun();
                 this->setPlayStart();
-//                this->playSelection();
+                this->setRunningStage(slotOn && playback && playPosition < playback->size() ?
+                        (*playback)[playPosition].stage : SlotPlay::Stage::song);
+                elapsedSeconds = timeline->midiToSeconds(past);
+                midiTime = timeline->secondsToMidiTime(elapsedSeconds);
+                elapsedSeconds += step;
+                if (this->followingClock()) {
+                    clockFollower = follower;
+                    clockFollower.rebase(endTime);
+                }
                 eosPulse.trigger();
-                this->advancePlayStart(0, INT_MAX);
-            }
-            if (!running) {
+                this->advancePlayStart(midiTime, INT_MAX);
+                playNotes = (bool) playStart;   // next slot's first notes start this sample
+            } else {
                 this->zeroGates();
+                playNotes = false;
             }
-            playNotes = false;
         }
     }
-#if DEBUG_CPU_TIME
-    double mid2 = system::getThreadTime();
-#endif
-    // if connected, set up all super eight outputs to last state before overwriting with new state
-    if (rightExpander.module && rightExpander.module->model == modelSuper8) {
-        Super8Data *message = (Super8Data*) rightExpander.module->leftExpander.producerMessage;
-        for (unsigned chan = 0; chan < EXPANSION_OUTPUTS; ++chan) {
-            message->exChannels[chan] = channels[chan].voiceCount;
-            const auto& vIn = channels[chan].voices;
+    profile.end(ProcessProfile::advance);
+    if (playNotes) {
+        this->startNotes(midiTime, running);
+    }
+    profile.end(ProcessProfile::notes);
+    this->copyToExpander(playNotes);
+    this->setHorizon(args, midiTime, playNotes, running);
+    ProcessProfile::Most(profile.notifyMax, reqs.size());
+    profile.end(ProcessProfile::expander);
+}
+
+// starts notes due at midi time; events before play start have expired, so only gate on
+// events from play next on may start notes
+void NoteTaker::startNotes(int midiTime, bool running) {
+    unsigned walked = 0;
+    unsigned started = 0;
+    const PlayTimeline& t = *timeline;
+    playNext = std::max(playNext, playStart);
+    unsigned sStart = INT_MAX;
+    // sounding notes follow transpose as it changes, not only notes started from now on
+    float bias = this->transpose();
+    if (bias != transposed) {
+        this->setTranspose(bias);
+    }
+    for (; playNext < t.size() && t.times[playNext] <= midiTime; ++playNext) {
+        ++walked;
+        // if not running, only play note on if it is in selection
+        if (!running && t.noteIndex[playNext] >= selectEnd) {
+            break;
+        }
+        if (PlayType::gateOn != t.types[playNext]) {
+            continue;
+        }
+        if (t.ends[playNext] <= midiTime) {
+            continue;
+        }
+        ++started;
+        unsigned chan = t.channels[playNext];
+        unsigned voiceIndex = t.voices[playNext];
+        auto& voice = channels[chan].voices[voiceIndex];
+        voice.event = playNext;
+        voice.realStart = realSeconds;
+        // to do : gate low should be set to sustain if slur is last note of non-running selection
+        if (chan < CV_OUTPUTS) {
+            outputs[GATE1_OUTPUT + chan].setVoltage(DEFAULT_GATE_HIGH_VOLTAGE, voiceIndex);
+        } else {
 #if DEBUG_GATES
-            if (debugVerbose && 4 == chan && !playNotes) {
-                static float last = -1;
-                static const float* lastAddr = nullptr;
-                if (last != vIn[0].gate || lastAddr != &vIn[0].gate) {
-                    DEBUG("[%g] vIn[0].gate %g %p", realSeconds, vIn[0].gate, &vIn[0].gate);
-                    last = vIn[0].gate;
-                    lastAddr = &vIn[0].gate;
-                }
+            if (debugVerbose && DEFAULT_GATE_HIGH_VOLTAGE != channels[chan].gates[voiceIndex]) {
+                DEBUG("[%g] chan %d gate %d from %g to DEFAULT_GATE_HIGH_VOLTAGE", realSeconds,
+                        chan, voiceIndex, channels[chan].gates[voiceIndex]);
             }
 #endif
-            for (unsigned voice = 0; voice < VOICE_COUNT; ++voice) {
-                if (chan >= CV_OUTPUTS) {
-                    message->exGate[chan - CV_OUTPUTS][voice] = vIn[voice].gate;
-                    message->exCv[chan - CV_OUTPUTS][voice] = vIn[voice].cv;
-                }
-                message->exVelocity[chan][voice] = vIn[voice].velocity;
-            }
+            channels[chan].gates[voiceIndex] = DEFAULT_GATE_HIGH_VOLTAGE;
         }
-    }
-#if DEBUG_CPU_TIME
-    double mid3 = system::getThreadTime();
-#endif
-    int debugIterations = 0;
-    int debugNotesSet = 0;
-    int debugNotesPlay = 0;
-    int debugNotesBias = 0;
-    if (playNotes) {
-//        unsigned start = playStart - 1;
-        --playStart;
-        unsigned sStart = INT_MAX;
-        do {
-            ++debugIterations;
-            const auto& note = n.notes[++playStart];
-            if (note.startTime > midiTime) {
-                break;
-            }
-            // if not running, only play note on if it is in selection
-            if (!running && playStart >= n.selectEnd) {
-                break;
-            }
-            if (NOTE_OFF == note.type) {
-                this->setExpiredGateLow(note);
-            }
-            if (NOTE_ON != note.type) {
-                continue;
-            }
-            int endTime = note.endTime();
-            if (endTime <= midiTime) {
-                continue;
-            }
-            ++debugNotesPlay;
-            auto& channelInfo = channels[note.channel];
-            SCHMICKLE((uint8_t) -1 != note.voice);
-            unsigned voiceIndex = note.voice;
-            auto& voice = channelInfo.voices[voiceIndex];
-            if (&note == voice.note) {
-                continue;
-            }
-            ++debugNotesSet;
-            voice.note = &note;
-            voice.realStart = realSeconds;
-            // to do : gate low should be set to sustain if slur is last note of non-running selection
-//                voice.gateLow = note.slurStart() ? INT_MAX : 
-//                        note.startTime + storage.current().channels[note.channel].sustain(note.duration);
-//                voice.noteEnd = endTime;
-            if (note.channel < CV_OUTPUTS) {
-                outputs[GATE1_OUTPUT + note.channel].setVoltage(DEFAULT_GATE_HIGH_VOLTAGE, voiceIndex);
-            } else if (note.channel < EXPANSION_OUTPUTS
-                    && rightExpander.module && rightExpander.module->model == modelSuper8) {
-                Super8Data *message = (Super8Data*) rightExpander.module->leftExpander.producerMessage;
-        #if DEBUG_GATES
-                if (debugVerbose && DEFAULT_GATE_HIGH_VOLTAGE
-                        != channels[note.channel].voices[voiceIndex].gate) {
-                    DEBUG("[%g] chan %d gate %d from %g to DEFAULT_GATE_HIGH_VOLTAGE", realSeconds,
-                            note.channel, voiceIndex, channels[note.channel].voices[voiceIndex].gate);
-                }
-        #endif
-                channels[note.channel].voices[voiceIndex].gate = DEFAULT_GATE_HIGH_VOLTAGE;
-                message->exGate[note.channel - CV_OUTPUTS][voiceIndex] = DEFAULT_GATE_HIGH_VOLTAGE;
-            }
-            if (running) {
-                sStart = std::min(sStart, playStart);
-            }
-            // recompute pitch all the time to prepare for tremelo / vibrato / slur / etc
-            if (note.channel < EXPANSION_OUTPUTS) {
-                ++debugNotesBias;
-                float bias = -60.f / 12;  // MIDI middle C converted to 1 volt/octave
-                const auto verticalWheel = ntw()->verticalWheel;
-                if (mainWidget->runningWithButtonsOff()) {
-                    bias += inputs[V_OCT_INPUT].getVoltage();
-                    bias += ((int) verticalWheel->getValue() - 60) / 12.f;
-                }
-                if (rightExpander.module && rightExpander.module->model == modelSuper8) {
-                    Super8Data *message = (Super8Data*) rightExpander.module->leftExpander.producerMessage;
-                    if (note.channel >= CV_OUTPUTS) {
-                        float newCV = bias + note.pitch() / 12.f;
-                        channels[note.channel].voices[voiceIndex].cv = newCV;
-                        message->exCv[note.channel - CV_OUTPUTS][voiceIndex] = newCV;
-                    }
-                    float velocity = note.onVelocity();
-                    channels[note.channel].voices[voiceIndex].velocity = velocity;
-                    message->exVelocity[note.channel][voiceIndex] = velocity;
-                }
-                if (note.channel < CV_OUTPUTS) {
+        if (running) {
+            sStart = std::min(sStart, t.noteIndex[playNext]);
+        }
+        float newCV = bias + t.cvs[playNext];
+        channels[chan].pitches[voiceIndex] = t.cvs[playNext];
+        channels[chan].cvs[voiceIndex] = newCV;
+        channels[chan].velocities[voiceIndex] = t.velocities[playNext];
+        this->markExpander(chan);
+        if (chan < CV_OUTPUTS) {
 #if DEBUG_RUN_TIME
-                    if (debugVerbose) DEBUG("setNote [%u] bias %g v_oct %g wheel %g pitch %g new %g old %g",
-                        note.channel, bias,
-                        inputs[V_OCT_INPUT].getVoltage(), verticalWheel->getValue(),
-                        note.pitch() / 12.f, bias + note.pitch() / 12.f,
-                        outputs[CV1_OUTPUT + note.channel].getVoltage(voiceIndex));
+            if (debugVerbose) DEBUG("setNote [%u] bias %g v_oct %g wheel %g new %g old %g",
+                chan, bias, inputs[V_OCT_INPUT].getVoltage(), params[VERTICAL_WHEEL].getValue(),
+                newCV, outputs[CV1_OUTPUT + chan].getVoltage(voiceIndex));
 #endif
-                    outputs[CV1_OUTPUT + note.channel].setVoltage(bias + note.pitch() / 12.f, voiceIndex);
-                }
-            }
-        } while (true);
-        if (running) {
-            // stage select start to display so that other thread sets display start later
-            if (INT_MAX != sStart && n.selectStart != sStart) {
-                n.selectStart = sStart;  // jam result in so this thread plays right note
-                ntw()->reqs.push({ReqType::setSelectStart, sStart}); // then compute full answer for display
-            }
+            outputs[CV1_OUTPUT + chan].setVoltage(newCV, voiceIndex);
+        }
+    }
+    if (running) {
+        // stage select start to display so that other thread sets display start later
+        if (INT_MAX != sStart && selectStart != sStart) {
+            selectStart = sStart;  // jam result in so this thread plays right note
+            this->notify({ReqType::setSelectStart, sStart}); // then compute full answer for display
         }
     }
-    if (rightExpander.module && rightExpander.module->model == modelSuper8) {
-        if (debugVerbose && !playNotes) {
-            Super8Data *message = (Super8Data*) rightExpander.module->leftExpander.producerMessage;
-            if (message->exGate[0][0]) {
-                DEBUG("[%g] expected zero gate", realSeconds);
-                _schmickled();
+    ProcessProfile::Bump(profile.events, (uint64_t) walked);
+    ProcessProfile::Bump(profile.notesStarted, (uint64_t) started);
+}
+
+// if connected, set up all super eight outputs to last state before overwriting with new state
+// publishes channels whose voices changed since the last block to chained super 8s; if none
+// changed, publishes nothing, and super 8s leave their outputs as they are
+void NoteTaker::copyToExpander(bool playNotes) {
+    if (!expanderDirty) {
+        return;
+    }
+    ExpanderBlock& block = expanderBus.write();
+    // block was last written two blocks ago; also rewrite what the prior block changed
+    for (unsigned bits = expanderDirty | expanderStale; bits; bits &= bits - 1) {
+        unsigned chan = __builtin_ctz(bits);
+        block.voiceCounts[chan] = channels[chan].voiceCount;
+        const auto& vIn = channels[chan];
+#if DEBUG_GATES
+        if (debugVerbose && 4 == chan && !playNotes) {
+            static float last = -1;
+            static const float* lastAddr = nullptr;
+            if (last != vIn.gates[0] || lastAddr != &vIn.gates[0]) {
+                DEBUG("[%g] vIn.gates[0] %g %p", realSeconds, vIn.gates[0], &vIn.gates[0]);
+                last = vIn.gates[0];
+                lastAddr = &vIn.gates[0];
             }
         }
-        rightExpander.module->leftExpander.messageFlipRequested = true;
-    }
-#if DEBUG_CPU_TIME
-    double endTime = system::getThreadTime();
-    double elapsed = endTime - startTime;
-    if (elapsed > worstTime) {
-        if (++reported > 1) {
-            worstTime = elapsed;
-            reportWorstLater = true;
+#endif
+        for (unsigned voice = 0; voice < VOICE_COUNT; voice += 4) {
+            simd::float_4::load(&vIn.gates[voice]).store(&block.gate[chan][voice]);
+            simd::float_4::load(&vIn.cvs[voice]).store(&block.cv[chan][voice]);
+            simd::float_4::load(&vIn.velocities[voice]).store(&block.velocity[chan][voice]);
         }
     }
-    if (0) reportWorstLater = true; // to do : remove this, debug debugging
-    if (reportWorstLater && endTime - lastTime > 0.3) {
-        DEBUG("worst time %g elapsed %g parts %g %g %g %g iter %d play %d set %d bias %d",
-                 worstTime, elapsed,
-                mid1 - startTime, mid2 - mid1, mid3 - mid2, endTime - mid3,
-                debugIterations, debugNotesPlay, debugNotesSet, debugNotesBias);
-        reportWorstLater = false;
-        lastTime = endTime;
+    if (debugVerbose && !playNotes && block.gate[CV_OUTPUTS][0]) {
+        DEBUG("[%g] expected zero gate", realSeconds);
+        _schmickled();
     }
-#endif
+    block.dirty = expanderDirty;
+    block.generation = ++expanderGeneration;
+    expanderBus.publish();
+    expanderStale = expanderDirty;
+    expanderDirty = 0;
+}
+
+// offsets cv of every voice from its note's pitch, four voices at a time
+void NoteTaker::setTranspose(float transpose) {
+    transposed = transpose;
+    const simd::float_4 bias = transpose;
+    for (unsigned chan = 0; chan < CHANNEL_COUNT; ++chan) {
+        auto& c = channels[chan];
+        if (!c.voiceCount) {
+            continue;
+        }
+        for (unsigned voice = 0; voice < c.voiceCount; voice += 4) {
+            simd::float_4 cv = simd::float_4::load(&c.pitches[voice]) + bias;
+            cv.store(&c.cvs[voice]);
+            if (chan < CV_OUTPUTS) {
+                outputs[CV1_OUTPUT + chan].setVoltageSimd(cv, voice);
+            }
+        }
+        this->markExpander(chan);
+    }
+}
+
+const ExpanderBus* NoteTakerExpanderBus(const Module* module) {
+    return module && modelNoteTaker == module->model ?
+            &((const NoteTaker*) module)->expanderBus : nullptr;
 }
 
 void NoteTaker::onReset() {
@@ -485,6 +647,7 @@ void NoteTaker::resetState(bool pushRequest) {
     for (auto& c : channels) {
         c.voiceCount = 0;
     }
+    expanderDirty = ALL_CHANNELS;
     this->resetRun(pushRequest);
 }
 
@@ -492,9 +655,9 @@ void NoteTaker::resetRun(bool pushRequest) {
     outputs[CLOCK_OUTPUT].setVoltage(DEFAULT_GATE_HIGH_VOLTAGE);
     elapsedSeconds = 0;
     clockHighTime = FLT_MAX;
-    externalClockTempo = stdMSecsPerQuarterNote;
+    clockFollower.restart();
     resetHighTime = FLT_MAX;
-    midiClockOut = n().ppq;
+    midiClockOut = timeline->ppq;
     clockTrigger.reset();
     eosTrigger.reset();
     resetTrigger.reset();
@@ -502,34 +665,179 @@ void NoteTaker::resetRun(bool pushRequest) {
     eosPulse.reset();
     resetTimer.reset();
     if (pushRequest) {
-        this->ntw()->reqs.push(ReqType::resetDisplayRange);
+        this->notify(ReqType::resetDisplayRange);
+    }
+}
+
+
+// count samples until the next timeline event, clock out pulse, or song end is due;
+// process() skips all note work for that many samples
+// horizon is capped to about one display frame so that ui changes that don't send requests
+// (buttons, selection, vertical wheel) are picked up promptly
+void NoteTaker::setHorizon(const ProcessArgs& args, int midiTime, bool playNotes, bool running) {
+    blockCount = 0;
+    blockNext = 0;
+    blockOffset = 0;
+    idleSampleTime = args.sampleTime;
+    idleWheel = params[HORIZONTAL_WHEEL].getValue();
+    unsigned maxIdle = (unsigned) (args.sampleRate / 60);
+    if (!playStart) {
+        idleStep = 0;
+        idleSamples = maxIdle;
+        return;
+    }
+    if (!playNotes) {   // play restarted this sample
+        return;
+    }
+    const PlayTimeline& t = *timeline;
+    int nextTime = std::min(std::min(t.ends[playStart], midiClockOut), midiEndTime);
+    if (playNext < t.size() && (running || t.noteIndex[playNext] < selectEnd)) {
+        nextTime = std::min(nextTime, t.times[playNext]);
+    }
+    if (nextTime <= midiTime) {
+        return;
+    }
+    idleStep = args.sampleTime * this->playRate();
+    if (idleStep <= 0) {
+        return;
+    }
+    // leave margin for rounding of summed steps and of converting seconds back to midi time
+    double nextSeconds = t.midiToSeconds(nextTime);
+    if (this->followingClock()) {
+        nextSeconds = std::min(nextSeconds, t.midiToSeconds(clockFollower.limit()));
+    }
+    double margin = elapsedSeconds * DBL_EPSILON * 16 + idleStep * 2;
+    double idle = (nextSeconds - elapsedSeconds - margin) / idleStep;
+    idleSamples = idle <= 0 ? 0 : (unsigned) std::min((double) maxIdle, idle);
+    if (blockSize > 1 && running) {
+        this->planBlock(idle, margin, maxIdle, midiTime);
+    }
+}
+
+// extends the horizon to block size samples, or further if the horizon is already longer,
+// past events due in the meantime: each midi time an event may start or end is scheduled with
+// the first sample that may reach it; only those samples expire and start notes, skipping
+// requests, inputs, and tempo, which process() reads in full when the block ends
+// the block ends before the song does, or before a followed clock's next edge is due, so
+// slot changes and clock waits stay with process()
+void NoteTaker::planBlock(double idle, double margin, unsigned maxIdle, int midiTime) {
+    const PlayTimeline& t = *timeline;
+    double endSeconds = t.midiToSeconds(std::min(midiEndTime, t.times.back()));
+    if (this->followingClock()) {
+        endSeconds = std::min(endSeconds, t.midiToSeconds(clockFollower.limit()));
+    }
+    double last = std::min(std::max(idle, (double) blockSize),
+            (endSeconds - elapsedSeconds - margin) / idleStep);
+    last = std::min(last, (double) maxIdle);
+    if (last <= std::max(idle, 0.)) {
+        return;
+    }
+    unsigned samples = (unsigned) last;
+    int windowEnd = t.secondsToMidiTime(elapsedSeconds + samples * idleStep);
+    unsigned count = 0;
+    auto schedule = [this, &count, midiTime, windowEnd](int time) {
+        if (midiTime < time && time <= windowEnd) {
+            if (count >= BLOCK_EVENTS) {
+                return false;
+            }
+            blockTimes[count++] = time;
+        }
+        return true;
+    };
+    for (int clockOut = midiClockOut; clockOut <= windowEnd; clockOut += t.ppq) {
+        if (!schedule(clockOut)) {
+            return;
+        }
+    }
+    // events from play start on may end in the block; events from play next on may start
+    for (unsigned event = playStart; event < t.size() && t.times[event] <= windowEnd; ++event) {
+        if (!schedule(t.ends[event]) || (event >= playNext && !schedule(t.times[event]))) {
+            return;     // too busy to schedule; keep plain horizon
+        }
+    }
+    std::sort(blockTimes.begin(), blockTimes.begin() + count);
+    count = std::unique(blockTimes.begin(), blockTimes.begin() + count) - blockTimes.begin();
+    for (unsigned index = 0; index < count; ++index) {
+        double offset = (t.midiToSeconds(blockTimes[index]) - elapsedSeconds - margin) / idleStep;
+        blockOffsets[index] = offset <= 0 ? 0 : (unsigned) offset;
+    }
+    blockCount = count;
+    idleSamples = samples;
+}
+
+// plays scheduled events on a sample within the block, if play has reached the next one
+void NoteTaker::playBlockSample() {
+    int midiTime = timeline->secondsToMidiTime(elapsedSeconds);
+    if (midiTime < blockTimes[blockNext]) {
+        return;     // scheduled sample was early to allow for rounding; try the next one
+    }
+    while (blockNext < blockCount && blockTimes[blockNext] <= midiTime) {
+        ++blockNext;
     }
+    ProcessProfile::Bump(profile.blockPlays);
+    if (midiTime >= midiClockOut) {
+        midiClockOut += timeline->ppq;
+        clockPulse.trigger();
+    }
+    this->moveEosBase(midiTime);
+    if (!this->advancePlayStart(midiTime, midiEndTime)) {
+        idleSamples = 0;    // let process() end the song or change slots
+        blockCount = 0;
+        return;
+    }
+    this->startNotes(midiTime, running);
 }
 
+// jumps play start forward to midi time in log time, instead of stepping event by event
+// skipped events have all ended, so any gate off among them is for a voice already low;
+// skipped tempo, key, and time signature events are applied in order
+void NoteTaker::seekPlayStart(int midiTime) {
+    const PlayTimeline& t = *timeline;
+    if (!t.size()) {
+        return;
+    }
+    // stop on track end, so that advance play start reports the end of the song
+    unsigned target = std::min(t.seek(midiTime), t.size() - 1);
+    if (target <= playStart) {
+        return;
+    }
+    for (auto meta = std::lower_bound(t.metas.begin(), t.metas.end(), playStart);
+            meta != t.metas.end() && *meta < target; ++meta) {
+        this->playMeta(*meta);
+    }
+    playStart = target;
+    playNext = std::max(playNext, playStart);
+}
+
+// switches to slot at end of prior one, in the same sample; widget follows along
+void NoteTaker::stageSlot(unsigned index) {
+    slotStart = std::min(index, (unsigned) SLOT_COUNT - 1);
+    selectStart = 0;
+    selectEnd = INT_MAX;
+    this->loadTimeline();
+    this->notify({ReqType::stagedSlotStart, slotStart});
+}
 
-void NoteTaker::setExpiredGateLow(const DisplayNote& note) {
-    auto c = note.channel;
+void NoteTaker::setExpiredGateLow(unsigned event) {
+    const PlayTimeline& t = *timeline;
+    auto c = t.channels[event];
     SCHMICKLE(c < CHANNEL_COUNT);
     auto& channel = channels[c];
-    auto v = note.voice;
-    if (v >= VOICE_COUNT) {
-        Notes::DebugDump(n().notes);
-    }
+    auto v = t.voices[event];
     SCHMICKLE(v < VOICE_COUNT);
     auto& voice = channel.voices[v];
-    if (!voice.note) {
+    // voice may have been stolen by a later note, or never started if outside selection
+    if ((unsigned) t.data[event] != voice.event) {
         return;
     }
     if (c < CV_OUTPUTS) {
         outputs[GATE1_OUTPUT + c].setVoltage(0, v);
     } else {
-        channel.voices[v].gate = 0;
+        channel.gates[v] = 0;
+        this->markExpander(c);
     }
-    SCHMICKLE(voice.note);
-    SCHMICKLE(voice.note->endTime() == note.startTime);
-    SCHMICKLE(voice.note->pitch() == note.pitch());
-    SCHMICKLE(voice.note->channel == note.channel);
-    voice.note = nullptr;
+    SCHMICKLE(t.ends[voice.event] == t.times[event]);
+    voice.event = INT_MAX;
 }
     
 // to do : add bool to note that some voice count has changed to skip this if there's nothing new
@@ -543,30 +851,20 @@ void NoteTaker::setOutputsVoiceCount() {
 void NoteTaker::setPlayStart() {
     this->zeroGates();
     tempo = stdMSecsPerQuarterNote;
+    this->loadTimeline();
     this->setVoiceCount();
-    auto& n = this->n();
-    playStart = this->ntw()->edit.voice ? n.selectStart : 0;
+    const PlayTimeline& t = *timeline;
+    playStart = editVoice ? t.noteToEvent(selectStart) : 0;
+    playNext = playStart;
     // if not running, midi end time is end time of longest note on in selection
-    if (this->isRunning() || n.selectEnd == n.notes.size()) {
-        midiEndTime = n.notes[n.notes.size() - 1].endTime();
-    } else {
-        midiEndTime = n.notes[n.selectStart].endTime();
-        for (unsigned index = n.selectStart + 1; index < n.selectEnd; ++index) {
-            auto& note = n.notes[index];
-            if (NOTE_ON == note.type) {
-                midiEndTime = std::max(midiEndTime, note.endTime());
-            }
-        }
-    }
+    midiEndTime = t.selectionEnd(selectStart, selectEnd, this->isRunning());
 #if DEBUG_RUN
-    if (debugVerbose) DEBUG("setPlayStart playStart %u midiEndTime %d lastNote %s", playStart,
-            midiEndTime, n.notes[lastNote].debugString(n.notes, nullptr, nullptr).c_str());
+    if (debugVerbose) DEBUG("setPlayStart playStart %u midiEndTime %d", playStart, midiEndTime);
 #endif
 }
 
-// to do : output debug data to show what set voice count did
+// voices are assigned when timeline is built; this copies its counts to the outputs' state
 void NoteTaker::setVoiceCount() {
-    auto& n = this->n();
 #if DEBUG_RUN
     DEBUG("setVoiceCount invalidVoiceCount %d", invalidVoiceCount);
 #endif
@@ -574,83 +872,11 @@ void NoteTaker::setVoiceCount() {
         return;
     }
     invalidVoiceCount = false;
-    size_t count = n.notes.size();
     for (unsigned chan = 0; chan < CHANNEL_COUNT; ++chan) {
-        channels[chan].voiceCount = 0;
-    }
-    if (!count) {
-        return;
-    }
-    vector<const DisplayNote* > overlaps;
-    overlaps.resize(CHANNEL_COUNT * VOICE_COUNT);
-    overlaps.clear();
-    --count;
-    if (TRACK_END != n.notes[count].type) {
-        Notes::DebugDump(n.notes);
-    }
-    SCHMICKLE(TRACK_END == n.notes[count].type);
-    array<unsigned, CHANNEL_COUNT * 128> onVoice;
-    onVoice.fill((unsigned) -1);
-    for (unsigned index = 0; index < count; ++index) {
-        auto& note = n.notes[index];
-        if (NOTE_OFF == note.type) {
-            if ((unsigned) -1 == onVoice[note.channel * 128 + note.pitch()]) {
-                Notes::DebugDump(n.notes);
-            }
-            SCHMICKLE((unsigned) -1 != onVoice[note.channel * 128 + note.pitch()]);
-            note.voice = onVoice[note.channel * 128 + note.pitch()];
-            onVoice[note.channel * 128 + note.pitch()] = (unsigned) -1;
-            continue;
+        if (channels[chan].voiceCount != timeline->voiceCounts[chan]) {
+            this->markExpander(chan);
         }
-        if (NOTE_ON != note.type) {
-            continue;
-        }
-        auto chan = note.channel;
-        auto overStart = &overlaps[chan * VOICE_COUNT];
-        const auto overEnd = overStart + VOICE_COUNT;
-        unsigned vCount = 1;
-        auto over = overStart - 1;
-        while (++over < overEnd) {
-            if (!*over) {
-                continue;
-            }
-            // to do : if note is slurred, allow one midi time unit of overlap
-            // -- or -- keep notes un-overlapped, overlap only when reading/writing midi...
-            if ((*over)->endTime() <= note.startTime) {
-                *over = nullptr;
-                continue;
-            }
-            ++vCount;
-#if DEBUG_VOICE_COUNT
-            DEBUG("%d over note %s", vCount, note.debugString().c_str());
-#endif
-        }
-        over = overStart - 1;
-        if (VOICE_COUNT < vCount) {
-            const DisplayNote** oldestOverlap = nullptr;
-            int oldestTime = INT_MAX;
-            while (++over < overEnd) {
-                if (oldestTime > (*over)->startTime) {
-                    oldestTime = (*over)->startTime;
-                    oldestOverlap = over;
-                }
-            }
-            *oldestOverlap = &note;
-        } else {
-            while (++over < overEnd) {
-                if (!*over) {
-                    *over = &note;
-                    break;
-                }
-            }
-        }
-        channels[chan].voiceCount =
-                std::max(channels[chan].voiceCount, vCount);
-        note.voice = over - overStart;
-        onVoice[note.channel * 128 + note.pitch()] = note.voice;
-#if DEBUG_VOICE_COUNT
-        DEBUG("%u vCount %d chan %d %s", index, vCount, chan, note.debugString().c_str());
-#endif
+        channels[chan].voiceCount = timeline->voiceCounts[chan];
     }
 }
 
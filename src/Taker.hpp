@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Channel.hpp"
+#include "Clock.hpp"
+#include "Profile.hpp"
+#include "Queue.hpp"
+#include "Render.hpp"
 #include "Storage.hpp"
 
 /* poly bugs
@@ -16,34 +20,41 @@ struct NoteTakerWidget;
 struct DisplayNote;
 
 struct Voice {
-    const DisplayNote* note = nullptr;  // the note currently playing on this channel
+    unsigned event = INT_MAX;  // timeline gate on currently playing on this channel, if any
     double realStart = 0;   // real time when note started (used to recycle voice)
 //    int gateLow = 0;        // midi time when gate goes low (start + sustain)
 //    int noteEnd = 0;        // midi time when note expires (start + duration)
-    // for super eight, also record last state of cv / gate/ velocity
-    float cv = 0;
-    float gate = 0;
-    float velocity = 0;
-
-    std::string debugString(const DisplayNote* base) const;
 };
 
 struct Voices {
     array<Voice, VOICE_COUNT> voices;
+    // last state of cv / gate / velocity, for expanders and velocity; one lane per voice,
+    // so that four voices at a time are copied with one vector load and store
+    alignas(16) array<float, VOICE_COUNT> cvs {};
+    alignas(16) array<float, VOICE_COUNT> pitches {};  // cv of note before transpose
+    alignas(16) array<float, VOICE_COUNT> gates {};
+    alignas(16) array<float, VOICE_COUNT> velocities {};
     unsigned voiceCount = 0;
+
+    std::string debugString(unsigned voice, const PlayTimeline& ) const;
 };
 
-// circular buffer holds requests to modify notetaker state
-// outside thread writes to buffer and then advances writer pointer when done
-// note taker thread reads from buffer and advances reader pointer when done
+// queued requests to modify notetaker state
 enum class RequestType : unsigned {
     invalidateAndPlay,
     invalidateVoiceCount,
     onReset,
     resetAndPlay,
     resetPlayStart,
+    setBlockSize,
     setClipboardLight,
+    setClockFollower,
+    setEditVoice,
     setPlayStart,
+    setRunning,
+    setSelectEnd,
+    setSelectStart,
+    setSlotStart,
 };
 
 struct RequestRecord {
@@ -59,9 +70,17 @@ struct RequestRecord {
             case RequestType::onReset: return "onReset";
             case RequestType::resetAndPlay: return "resetAndPlay";
             case RequestType::resetPlayStart: return "resetPlayStart";
+            case RequestType::setBlockSize: return "setBlockSize: " + std::to_string(data);
             case RequestType::setClipboardLight: return "setClipboardLight: "
                     + std::to_string((float) data / 256.f);
+            case RequestType::setClockFollower: return "setClockFollower: ppqn "
+                    + std::to_string(data >> 8) + " smoothing " + std::to_string(data & 0xFF);
+            case RequestType::setEditVoice: return "setEditVoice: " + std::to_string(data);
             case RequestType::setPlayStart: return "setPlayStart";
+            case RequestType::setRunning: return "setRunning: " + std::to_string(data);
+            case RequestType::setSelectEnd: return "setSelectEnd: " + std::to_string(data);
+            case RequestType::setSelectStart: return "setSelectStart: " + std::to_string(data);
+            case RequestType::setSlotStart: return "setSlotStart: " + std::to_string(data);
             default:
                 assert(0);  // incomplete
         }
@@ -69,36 +88,60 @@ struct RequestRecord {
     }
 };
 
-struct Requests {
-    array<RequestRecord, 16> buffer;
-    RequestRecord* reader;
-    RequestRecord* writer;
+// written by ui thread, read by note taker thread
+struct Requests : SpscQueue<RequestRecord, 64> {
+    using SpscQueue::push;
 
-    bool empty() const {
-        return reader == writer;
+    void push(RequestType type) {
+        this->push({type, 0});
     }
+};
+
+// queued requests to modify widget state
+enum class ReqType : unsigned {
+    nothingToDo,
+    resetDisplayRange,
+    resetXAxisOffset,
+    insertNote,
+    runButtonActivate,
+    setSelectStart,
+    stagedSlotStart,
+};
 
-    RequestRecord pop() {
-        SCHMICKLE(reader != writer);
-        if (reader < writer) {
-            writer = &buffer.front();
+struct ReqRecord {
+    ReqType type;
+    unsigned data;
+
+    std::string debugStr() const {
+        std::string result;
+        switch(type) {
+            case ReqType::nothingToDo: return "nothingToDo";
+            case ReqType::resetDisplayRange: return "resetDisplayRange";
+            case ReqType::resetXAxisOffset: return "resetXAxisOffset";
+            case ReqType::insertNote: return "insertNote: duration " + std::to_string(data >> 8)
+                    + " pitch " + std::to_string(data & 0x7F);
+            case ReqType::runButtonActivate: return "runButtonActivate";
+            case ReqType::setSelectStart: return "setSelectStart: " + std::to_string(data);
+            case ReqType::stagedSlotStart: return "stagedSlotStart: " + std::to_string(data);
+            default:
+                assert(0);  // incomplete
         }
-        return *writer++;
+        return "";
     }
+};
 
-    void push(const RequestRecord& record) {
-        RequestRecord* temp = reader == &buffer.back() ? &buffer.front() : reader;
-        *temp = record;
-        reader = temp + 1;
-    }
+// written by note taker thread, read by ui thread
+struct Reqs : SpscQueue<ReqRecord, 64> {
+    using SpscQueue::push;
 
-    void push(RequestType type) {
+    void push(ReqType type) {
         this->push({type, 0});
     }
 };
 
 // most state in note taker should not be altered by the display/ui thread
-// to do : do not write playStart except directly or indirectly by process()
+// note taker owns the slots and plays them without a widget; an attached widget edits slots
+// and sends its state (run button, selection, staged slot) as requests
 struct NoteTaker : Module {
 	enum ParamIds {       // numbers used by unit test
         RUN_BUTTON,       // 0
@@ -149,7 +192,13 @@ struct NoteTaker : Module {
 
     const unsigned UNASSIGNED_VOICE_INDEX = (unsigned) -1;
 
-    Requests requests;
+    Requests requests;      // written by widget
+    Reqs reqs;              // read by widget
+    SlotArray storage;      // written by widget; process() reads only published timelines
+    ClockFollower clockFollower;  // settings read by widget, written through requests
+    ExpanderBus expanderBus;      // read by chained super 8s
+    ProcessProfile profile;       // process() timing, read by widget's context menu
+    unsigned blockSize = 32;      // samples of events scheduled ahead; read by widget
 private:  // avoid directly accessing cross-thread stuff
     // state saved into json
     // written by step:
@@ -162,9 +211,19 @@ private:  // avoid directly accessing cross-thread stuff
     dsp::Timer resetTimer;
     // end of state saved into json; written by step
     NoteTakerWidget* mainWidget = nullptr;
-    double elapsedSeconds = 0;              // seconds into score (float is not enough bits)
+    std::shared_ptr<const PlayTimeline> timeline;  // compiled copy of slot notes being played
+    std::shared_ptr<const vector<SlotPlay>> playback;  // copy of slot playback order
+    double elapsedSeconds = 0;              // seconds into score at score tempo; see tempo map
     double realSeconds = 0;                 // seconds for UI timers
-    unsigned playStart = 0;                 // index of notes output
+    unsigned playStart = 0;                 // first timeline event not yet expired
+    unsigned playNext = 0;                  // first timeline event not yet started
+    // copies of widget state, sent by ui thread
+    unsigned selectStart = 0;
+    unsigned selectEnd = 1;
+    unsigned slotStart = 0;                 // index into playback of slot being played
+    unsigned playPosition = 0;              // entry in playback being played (not saved)
+    bool editVoice = false;
+    bool running = false;
     int midiEndTime = INT_MAX;
     int eosBase = INT_MAX;    // during playback, start of bar/quarter note in midi ticks
     int eosInterval = 0;      // duration of bar/quarter note in midi ticks
@@ -172,19 +231,38 @@ private:  // avoid directly accessing cross-thread stuff
     // clock input state (not saved)
     float clockCycle = 0;
     float clockHighTime = FLT_MAX;
-    int externalClockTempo = stdMSecsPerQuarterNote;
     int tempo = stdMSecsPerQuarterNote;     // default to 120 beats/minute (500,000 ms per qn)
     // reset input state (not saved)
     float resetCycle = 0;
     float resetHighTime = FLT_MAX;
     int midiClockOut = INT_MAX;
+    // event horizon: samples process() may skip before next event is due (not saved)
+    unsigned idleSamples = 0;
+    double idleStep = 0;                    // elapsed seconds added per skipped sample
+    float idleSampleTime = 0;               // sample time horizon was computed for
+    float idleWheel = 0;                    // horizontal wheel value horizon was computed for
     SlotPlay::Stage runningStage;
 //    unsigned stagedSlotStart = INT_MAX;
     bool invalidVoiceCount = false;
+    // super 8 messaging (not saved)
+    unsigned expanderDirty = 0;             // bit set for each channel changed since published
+    unsigned expanderStale = 0;             // channels published last time; write block lacks them
+    unsigned expanderGeneration = 0;
+    float transposed = 0;                   // transpose last applied to voice cvs (not saved)
+    // block: midi times events may fall due within the horizon, and the sample each may first
+    // be reached; only those samples expire and start notes (not saved)
+    static constexpr unsigned BLOCK_EVENTS = 64;
+    array<int, BLOCK_EVENTS> blockTimes;
+    array<unsigned, BLOCK_EVENTS> blockOffsets;
+    unsigned blockCount = 0;
+    unsigned blockNext = 0;                 // first scheduled time not yet reached
+    unsigned blockOffset = 0;               // samples skipped since horizon was set
 
 public:
     NoteTaker();
     float beatsPerHalfSecond(int tempo) const;
+    double playRate() const;
+    float tempoRatio() const;
 
     double getRealSeconds() const {
         return realSeconds;
@@ -194,11 +272,28 @@ public:
         return tempo;
     }
 
+    // channels with outputs: those on note taker, and those of each super 8 chained to the right
     static int OutputCount(const NoteTaker* nt) {
-        return nt && nt->rightExpander.module && modelSuper8 == nt->rightExpander.module->model ?
-                EXPANSION_OUTPUTS : CV_OUTPUTS;
+        unsigned chain = 0;
+        for (const Module* right = nt ? nt->rightExpander.module : nullptr;
+                right && modelSuper8 == right->model && chain < SUPER8_CHAIN_MAX;
+                right = right->rightExpander.module) {
+            ++chain;
+        }
+        return CV_OUTPUTS + SUPER8_CV_OUTPUTS * chain;
     }
 
+    void publishStorage();
+
+    // samples of lookahead; one schedules nothing ahead
+    static bool ValidBlockSize(unsigned size) {
+        return size && size <= 256 && !(size & (size - 1));
+    }
+
+    static std::unique_ptr<NoteTaker> CreateRenderer(const std::string& midiPath);
+    bool render(float seconds, float sampleRate, FILE* trace, bool timeSamples, RenderStats* stats,
+            const std::atomic<bool>* cancel = nullptr, std::atomic<unsigned>* rendered = nullptr);
+
     // note: only called by unit test
     void resetState(bool pushRequest = true);
 
@@ -221,16 +316,16 @@ private:
 #if DEBUG_CPU_TIME
         unsigned startPlayTime = playStart;
 #endif
+        const PlayTimeline& t = *timeline;
         do {
-            const auto& note = n().notes[playStart];
-            if (midiTime < note.endTime()) {
+            if (midiTime < t.ends[playStart]) {
                 switch (runningStage) {
                     case SlotPlay::Stage::step:
                     case SlotPlay::Stage::beat:
                         eosBase = midiTime;
                         break;
                     case SlotPlay::Stage::quarterNote:
-                        eosBase += (midiTime - eosBase) / n().ppq * n().ppq;
+                        eosBase += (midiTime - eosBase) / t.ppq * t.ppq;
                         break;
                     case SlotPlay::Stage::bar:
                         eosBase += (midiTime  - eosBase) / eosInterval * eosInterval;
@@ -239,35 +334,21 @@ private:
                         ;
                 }
 #if DEBUG_CPU_TIME
-                if (debugVerbose) DEBUG("%d %s playTime %u to %u note %s end %d", midiTime, __func__,
-                        startPlayTime, playStart, note.debugString().c_str(), note.endTime());
+                if (debugVerbose) DEBUG("%d %s playTime %u to %u event %s", midiTime, __func__,
+                        startPlayTime, playStart, t.debugString(playStart).c_str());
 #endif
                 return true;
             }
-            switch (note.type) {
-                case NOTE_OFF:
-                    this->setExpiredGateLow(note);
+            switch (t.types[playStart]) {
+                case PlayType::gateOff:
+                    this->setExpiredGateLow(playStart);
                     break;
-                case MIDI_TEMPO:
-                    if (this->isRunning()) {
-                        tempo = note.tempo();
-                        externalClockTempo = 
-                                (int) ((float) externalClockTempo / stdMSecsPerQuarterNote * tempo);
-                        if (debugVerbose) DEBUG("tempo: %d extern: %d", tempo, externalClockTempo);
-                    }
-                    // fall through
-                case KEY_SIGNATURE:
-                    if (SlotPlay::Stage::bar == runningStage) {
-                        eosBase = note.startTime;
-                    }
+                case PlayType::tempo:
+                case PlayType::keySignature:
+                case PlayType::timeSignature:
+                    this->playMeta(playStart);
                     break;
-                case TIME_SIGNATURE:
-                    if (SlotPlay::Stage::bar == runningStage) {
-                        eosBase = note.startTime;
-                        eosInterval = n().ppq * 4 * note.numerator() / (1 << note.denominator());
-                    }
-                    break;
-                case TRACK_END:
+                case PlayType::trackEnd:
 #if DEBUG_CPU_TIME
                 if (debugVerbose) DEBUG("%s playTime %u to %u", __func__, startPlayTime, playStart);
 #endif
@@ -276,13 +357,69 @@ private:
                     ;
             }
             ++playStart;
-            if (debugVerbose && playStart >= n().notes.size()) {
-                DEBUG("playStart %u n().notes.size() %u", playStart, n().notes.size());
+            if (debugVerbose && playStart >= t.size()) {
+                DEBUG("playStart %u timeline size %u", playStart, t.size());
             }
-            SCHMICKLE(playStart < n().notes.size());
+            SCHMICKLE(playStart < t.size());
         } while (true);
     }
 
+    void copyToExpander(bool playNotes);
+    void planBlock(double idle, double margin, unsigned maxIdle, int midiTime);
+    void playBlockSample();
+    void setTranspose(float transpose);
+    void startNotes(int midiTime, bool running);
+
+    // volts added to every note's pitch: v/oct input plus vertical wheel, while running
+    float transpose() const {
+        if (!this->isRunning() || this->menuButtonOn()) {
+            return 0;
+        }
+        return inputs[V_OCT_INPUT].getVoltage()
+                + ((int) params[VERTICAL_WHEEL].getValue() - 60) / 12.f;
+    }
+
+    // notes that voices on channel changed, so super 8 is sent them
+    void markExpander(unsigned chan) {
+        expanderDirty |= (1 << chan) & ALL_CHANNELS;
+    }
+
+    // moves slot ending condition so it is always equal to or ahead of play
+    void moveEosBase(int midiTime) {
+        if (eosBase < midiTime) {
+            eosBase = midiTime;
+            if (eosInterval) {
+                eosBase += eosInterval - midiTime % eosInterval;
+            }
+        }
+    }
+
+    // sets tempo and slot ending condition from tempo, key, or time signature event
+    void playMeta(unsigned event) {
+        const PlayTimeline& t = *timeline;
+        switch (t.types[event]) {
+            case PlayType::tempo:
+                if (this->isRunning()) {
+                    tempo = t.data[event];
+                    if (debugVerbose) DEBUG("tempo: %d", tempo);
+                }
+                // fall through
+            case PlayType::keySignature:
+                if (SlotPlay::Stage::bar == runningStage) {
+                    eosBase = t.times[event];
+                }
+                break;
+            case PlayType::timeSignature:
+                if (SlotPlay::Stage::bar == runningStage) {
+                    eosBase = t.times[event];
+                    eosInterval = t.data[event];
+                }
+                break;
+            default:
+                _schmickled();
+        }
+    }
+
     void dataFromJson(json_t* rootJ) override;
     json_t* dataToJson() override;
 
@@ -290,91 +427,53 @@ private:
         for (unsigned index = 0; index < CHANNEL_COUNT; ++index) {
             auto& c = channels[index];
             for (unsigned inner = 0; inner < c.voiceCount; ++inner) {
-                auto& v = c.voices[inner];
-                if (!v.note) {
+                if (INT_MAX == c.voices[inner].event) {
                     continue;
                 }
-                DEBUG("[%u / %u] %s", index, inner, v.debugString(&n().notes.front()).c_str());
+                DEBUG("[%u / %u] %s", index, inner, c.debugString(inner, *timeline).c_str());
             }
         }
     }
 
-    int externalTempo();
+    void followClock();
+    bool followingClock() const {
+        return inputs[CLOCK_INPUT].isConnected() && this->isRunning();
+    }
+
     void invalidateAndPlay(Inval inval);
-    bool isRunning() const;
+    bool isRunning() const {
+        return running;
+    }
 
-    Notes& n();
-    const Notes& n() const;
+    bool menuButtonOn() const;
 
-    // to do : remove this -- require access to be const
-    NoteTakerWidget* ntw() {
-        return mainWidget;
+    // widget may be absent: note taker plays without it
+    void notify(const ReqRecord& record) {
+        if (mainWidget) {
+            reqs.push(record);
+        }
     }
 
-    const NoteTakerWidget* ntw() const {
-        return mainWidget;
+    void notify(ReqType type) {
+        this->notify({type, 0});
     }
 
+
+    void loadPlayback();
+    void loadTimeline();
+    unsigned playbackPosition() const;
     void playSelection();
     void resetRun(bool pushRequest = true);
+    void seekPlayStart(int midiTime);
 
     void setClipboardLight(float brightness) {
         lights[CLIPBOARD_ON_LIGHT].setBrightness(brightness);
     }
 
-    void setExpiredGateLow(const DisplayNote& note);
-
-#if 0
-    void setExpiredGatesLow(int midiTime) {
-#if DEBUG_GATES
-        static array<unsigned, CHANNEL_COUNT> debugVoiceCount;
-#endif
-        bool hasExpander = rightExpander.module && modelSuper8 == rightExpander.module->model;
-        unsigned chanCount = hasExpander ? EXPANSION_OUTPUTS : CV_OUTPUTS;
-        for (unsigned channel = 0; channel < chanCount; ++channel) {
-            auto& c = channels[channel];
-#if DEBUG_GATES
-            if (debugVerbose && debugVoiceCount[channel] != c.voiceCount) {
-                DEBUG("[%g] %s chan %u voice count %u", realSeconds, __func__, channel, c.voiceCount);
-                debugVoiceCount[channel] = c.voiceCount;
-            }
-#endif
-            for (unsigned index = 0; index < c.voiceCount; ++index) {
-                auto& voice = c.voices[index];
-                if (!voice.note) {
-                    continue;
-                }
-//                if (voice.gateLow && voice.gateLow < midiTime) {
-//                    voice.gateLow = 0;
-                    if (channel < CV_OUTPUTS) {
-            #if DEBUG_GATES
-                        if (debugVerbose) {
-                            if (outputs[GATE1_OUTPUT + channel].getVoltage(index)) {
-                                DEBUG("[%g] %s set expired low [%u / %u]", realSeconds, __func__,
-                                        channel, index);
-                            }
-                        }
-            #endif
-                        outputs[GATE1_OUTPUT + channel].setVoltage(0, index);
-                    } else {
-            #if DEBUG_GATES
-                        if (debugVerbose) {
-                            if (channels[channel].voices[index].gate) {
-                                DEBUG("[%g] %s set expired low [%u / %u]", realSeconds, __func__,
-                                        channel, index);
-                            }
-                        }
-            #endif
-                        channels[channel].voices[index].gate = 0;
-                    }
-//                }
-//                if (voice.noteEnd < midiTime) {
-//                    voice.noteEnd = 0;
-//                }
-            }
-        }
-    }
-#endif
+    void setExpiredGateLow(unsigned event);
+    void setRunningStage(SlotPlay::Stage stage);
+    void stageSlot(unsigned index);
+    void setHorizon(const ProcessArgs& args, int midiTime, bool playNotes, bool running);
 
     void setPlayStart();
     void setOutputsVoiceCount();
@@ -388,22 +487,21 @@ private:
             auto& c = channels[index];
             for (unsigned inner = 0; inner < c.voiceCount; ++inner) {
                 auto& voice = c.voices[inner];
-                voice.note = nullptr;
+                voice.event = INT_MAX;
                 voice.realStart = 0;
-//                voice.gateLow = voice.noteEnd = 0;
             }
         }
+        const simd::float_4 zero = 0;
         for (unsigned index = 0; index < CV_OUTPUTS; ++index) {
-            for (unsigned inner = 0; inner < channels[index].voiceCount; ++inner) {
-                outputs[GATE1_OUTPUT + index].setVoltage(0, inner);
+            for (unsigned inner = 0; inner < channels[index].voiceCount; inner += 4) {
+                outputs[GATE1_OUTPUT + index].setVoltageSimd(zero, inner);
             }
         }
-        if (rightExpander.module && modelSuper8 == rightExpander.module->model) {
-            for (unsigned index = CV_OUTPUTS; index < EXPANSION_OUTPUTS; ++index) {
-                for (unsigned inner = 0; inner < channels[index].voiceCount; ++inner) {
-                    channels[index].voices[inner].gate = 0;
-                }
+        for (unsigned index = CV_OUTPUTS; index < CHANNEL_COUNT; ++index) {
+            for (unsigned inner = 0; inner < channels[index].voiceCount; inner += 4) {
+                zero.store(&channels[index].gates[inner]);
             }
+            this->markExpander(index);
         }
     }
 };
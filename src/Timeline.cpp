@@ -0,0 +1,345 @@
+#include "Timeline.hpp"
+
+// fnv-1a over every field build reads, so equal notes have equal keys
+PlayKeys::PlayKeys(const Notes& n,
+        const array<NoteTakerChannel, CHANNEL_COUNT>& channelPolicies) {
+    auto mix = [](uint64_t hash, const void* bytes, size_t count) {
+        for (size_t index = 0; index < count; ++index) {
+            hash = (hash ^ ((const uint8_t*) bytes)[index]) * 0x100000001b3;
+        }
+        return hash;
+    };
+    const uint64_t basis = 0xcbf29ce484222325;
+    uint64_t total = mix(basis, &n.ppq, sizeof(n.ppq));
+    for (const auto& channel : channelPolicies) {
+        total = mix(total, &channel.allocate, sizeof(channel.allocate));
+        total = mix(total, &channel.steal, sizeof(channel.steal));
+    }
+    keys.reserve(n.notes.size());
+    for (const auto& note : n.notes) {
+        uint64_t key = mix(basis, &note.startTime, sizeof(note.startTime));
+        key = mix(key, &note.duration, sizeof(note.duration));
+        key = mix(key, note.data, sizeof(note.data));
+        key = mix(key, &note.channel, sizeof(note.channel));
+        key = mix(key, &note.type, sizeof(note.type));
+        keys.push_back(key);
+        total = (total ^ key) * 0x100000001b3;
+    }
+    hash = (size_t) total;
+}
+
+// true if building from notes with these keys and channels would make this timeline
+bool PlayTimeline::builtFrom(const PlayKeys& playKeys, int notesPpq,
+        const array<NoteTakerChannel, CHANNEL_COUNT>& channelPolicies) const {
+    if (ppq != notesPpq) {
+        return false;
+    }
+    for (unsigned chan = 0; chan < CHANNEL_COUNT; ++chan) {
+        if (allocates[chan] != channelPolicies[chan].allocate
+                || steals[chan] != channelPolicies[chan].steal) {
+            return false;
+        }
+    }
+    return keys == playKeys.keys;
+}
+
+// copies events generated by notes before first into this, along with voice counts so far
+void PlayTimeline::copyPrefix(const PlayTimeline& prior, unsigned first) {
+    unsigned count = prior.noteToEvent(first);
+    times.assign(prior.times.begin(), prior.times.begin() + count);
+    ends.assign(prior.ends.begin(), prior.ends.begin() + count);
+    noteIndex.assign(prior.noteIndex.begin(), prior.noteIndex.begin() + count);
+    data.assign(prior.data.begin(), prior.data.begin() + count);
+    cvs.assign(prior.cvs.begin(), prior.cvs.begin() + count);
+    velocities.assign(prior.velocities.begin(), prior.velocities.begin() + count);
+    types.assign(prior.types.begin(), prior.types.begin() + count);
+    channels.assign(prior.channels.begin(), prior.channels.begin() + count);
+    voices.assign(prior.voices.begin(), prior.voices.begin() + count);
+    maxEnds.assign(prior.maxEnds.begin(), prior.maxEnds.begin() + count);
+    metas.assign(prior.metas.begin(),
+            std::lower_bound(prior.metas.begin(), prior.metas.end(), count));
+    noteStarts.assign(prior.noteStarts.begin(), prior.noteStarts.begin() + first);
+    noteEnds.assign(prior.noteEnds.begin(), prior.noteEnds.begin() + first);
+    keys.assign(prior.keys.begin(), prior.keys.begin() + first);
+    for (unsigned event = 0; event < count; ++event) {
+        if (PlayType::gateOn == types[event]) {
+            voiceCounts[channels[event]] =
+                    std::max(voiceCounts[channels[event]], (unsigned) data[event]);
+        }
+    }
+}
+
+// assigns poly voices while compiling, choosing among free voices and stealing a voice when
+// a note overlaps all voices on its channel as the channel's allocate and steal policies say
+// free voices are kept as a bit set per channel, so choosing one doesn't search voices
+// if prior is built from the same notes up to some index, its events before that are reused,
+// and voices are assigned only from the first changed note on
+void PlayTimeline::build(const Notes& n, const PlayKeys& playKeys,
+        const array<NoteTakerChannel, CHANNEL_COUNT>& channelPolicies, const PlayTimeline* prior) {
+    this->clear();
+    ppq = n.ppq;
+    bool anySamePitch = false;
+    for (unsigned chan = 0; chan < CHANNEL_COUNT; ++chan) {
+        allocates[chan] = channelPolicies[chan].allocate;
+        steals[chan] = channelPolicies[chan].steal;
+        anySamePitch |= NoteTakerChannel::Allocate::samePitch == allocates[chan];
+    }
+    if (n.notes.empty()) {
+        return;
+    }
+    unsigned first = 0;
+    // voice last played by each pitch isn't recovered from reused events, so rebuild from
+    // scratch if any channel reuses voices by pitch
+    if (prior && prior->ppq == ppq && prior->allocates == allocates && prior->steals == steals
+            && !anySamePitch) {
+        const auto& priorKeys = prior->keys;
+        first = std::mismatch(priorKeys.begin(), priorKeys.begin()
+                + std::min(priorKeys.size(), playKeys.keys.size()), playKeys.keys.begin()).first
+                - priorKeys.begin();
+        if (first == n.notes.size() && first == priorKeys.size()) {
+            first = 0;  // nothing changed; rebuild rather than special case copying all
+        }
+    }
+    this->reserve(n.notes.size());
+    if (first) {
+        this->copyPrefix(*prior, first);
+    }
+    constexpr unsigned allVoices = (1 << VOICE_COUNT) - 1;
+    // bit set for each voice playing a note, per channel
+    array<unsigned, CHANNEL_COUNT> busy;
+    busy.fill(0);
+    // gate on event playing each channel / voice combination; valid only if voice is busy
+    array<unsigned, CHANNEL_COUNT * VOICE_COUNT> overlaps;
+    // gate on event playing each channel / pitch combination
+    array<unsigned, CHANNEL_COUNT * 128> onEvent;
+    onEvent.fill(INT_MAX);
+    // round robin: first voice considered for next note, per channel
+    array<unsigned, CHANNEL_COUNT> nextVoice;
+    nextVoice.fill(0);
+    // same pitch: voice that last played each channel / pitch combination
+    array<uint8_t, CHANNEL_COUNT * 128> pitchVoice;
+    pitchVoice.fill(0);
+    if (first) {
+        // recover allocator state at first changed note from reused events; any event still
+        // holding a voice or waiting for its note off ends at or after the changed note starts
+        auto pitchIndex = [this](unsigned event) {
+            return channels[event] * 128 + (int) std::lround(cvs[event] * 12 + 60);
+        };
+        for (unsigned event = this->seek(n.notes[first].startTime - 1); event < this->size();
+                ++event) {
+            if (PlayType::gateOn == types[event]) {
+                overlaps[channels[event] * VOICE_COUNT + voices[event]] = event;
+                busy[channels[event]] |= 1 << voices[event];
+                onEvent[pitchIndex(event)] = event;
+            } else if (PlayType::gateOff == types[event]) {
+                unsigned on = data[event];
+                unsigned& pending = onEvent[pitchIndex(on)];
+                if (pending == on) {
+                    pending = INT_MAX;
+                }
+            }
+        }
+        // round robin resumes after the last voice each channel chose
+        unsigned unfound = 0;
+        for (unsigned chan = 0; chan < CHANNEL_COUNT; ++chan) {
+            if (voiceCounts[chan] && NoteTakerChannel::Allocate::roundRobin == allocates[chan]) {
+                unfound |= 1 << chan;
+            }
+        }
+        for (unsigned event = this->size(); unfound && event--; ) {
+            if (PlayType::gateOn == types[event] && (unfound & (1 << channels[event]))) {
+                nextVoice[channels[event]] = voices[event] + 1;
+                unfound &= ~(1 << channels[event]);
+            }
+        }
+    }
+    if (TRACK_END != n.notes.back().type) {
+        Notes::DebugDump(n.notes);
+    }
+    SCHMICKLE(TRACK_END == n.notes.back().type);
+    keys.insert(keys.end(), playKeys.keys.begin() + first, playKeys.keys.end());
+    for (unsigned index = first; index < n.notes.size(); ++index) {
+        const DisplayNote& note = n.notes[index];
+        noteStarts.push_back(note.startTime);
+        noteEnds.push_back(note.endTime());
+        switch (note.type) {
+            case MIDI_HEADER:
+                this->add(PlayType::header, note, index);
+                break;
+            case NOTE_OFF: {
+                unsigned& on = onEvent[note.channel * 128 + note.pitch()];
+                if (INT_MAX == on) {
+                    Notes::DebugDump(n.notes);
+                }
+                SCHMICKLE(INT_MAX != on);
+                if (INT_MAX == on) {
+                    break;
+                }
+                this->add(PlayType::gateOff, note, index, on);
+                voices.back() = voices[on];
+                on = INT_MAX;
+                } break;
+            case NOTE_ON: {
+                unsigned chan = note.channel;
+                const unsigned* over = &overlaps[chan * VOICE_COUNT];
+                unsigned& playing = busy[chan];
+                // free voices whose notes have ended
+                // to do : if note is slurred, allow one midi time unit of overlap
+                for (unsigned bits = playing; bits; bits &= bits - 1) {
+                    unsigned voice = __builtin_ctz(bits);
+                    if (ends[over[voice]] <= note.startTime) {
+                        playing &= ~(1 << voice);
+                    }
+                }
+                unsigned vCount = __builtin_popcount(playing) + 1;
+                unsigned idle = ~playing & allVoices;
+                unsigned voice = 0;
+                if (!idle) {
+                    voice = this->stealVoice(steals[chan], over);
+                } else {
+                    switch (allocates[chan]) {
+                        case NoteTakerChannel::Allocate::lowestFree:
+                            voice = __builtin_ctz(idle);
+                            break;
+                        case NoteTakerChannel::Allocate::roundRobin: {
+                            unsigned after = idle & (allVoices << nextVoice[chan]) & allVoices;
+                            voice = __builtin_ctz(after ? after : idle);
+                            nextVoice[chan] = voice + 1;
+                            } break;
+                        case NoteTakerChannel::Allocate::samePitch: {
+                            unsigned last = pitchVoice[chan * 128 + note.pitch()];
+                            voice = idle & (1 << last) ? last : __builtin_ctz(idle);
+                            } break;
+                        default:
+                            _schmickled();
+                    }
+                }
+                playing |= 1 << voice;
+                overlaps[chan * VOICE_COUNT + voice] = this->size();
+                pitchVoice[chan * 128 + note.pitch()] = voice;
+                voiceCounts[chan] = std::max(voiceCounts[chan], std::min(vCount, VOICE_COUNT));
+                onEvent[chan * 128 + note.pitch()] = this->size();
+                this->add(PlayType::gateOn, note, index, std::min(vCount, VOICE_COUNT));
+                voices.back() = voice;
+#if DEBUG_VOICE_COUNT
+                DEBUG("%u vCount %d chan %d %s", index, vCount, chan, note.debugString().c_str());
+#endif
+                } break;
+            case MIDI_TEMPO:
+                metas.push_back(this->size());
+                this->add(PlayType::tempo, note, index, note.tempo());
+                break;
+            case KEY_SIGNATURE:
+                metas.push_back(this->size());
+                this->add(PlayType::keySignature, note, index);
+                break;
+            case TIME_SIGNATURE:
+                metas.push_back(this->size());
+                this->add(PlayType::timeSignature, note, index,
+                        ppq * 4 * note.numerator() / (1 << note.denominator()));
+                break;
+            case TRACK_END:
+                this->add(PlayType::trackEnd, note, index);
+                break;
+            default:
+                ;   // rests and unplayed midi don't change outputs
+        }
+    }
+    this->buildTempoMap();
+}
+
+// accumulates seconds across tempo changes in double, so that positions late in long
+// scores don't drift as summed per sample float conversions did
+void PlayTimeline::buildTempoMap() {
+    this->clearTempoMap();
+    for (unsigned meta : metas) {
+        if (PlayType::tempo != types[meta] || data[meta] <= 0) {
+            continue;
+        }
+        int time = times[meta];
+        if (time == tempoTimes.back()) {
+            tempoUsecs.back() = data[meta];
+            continue;
+        }
+        tempoSeconds.push_back(this->midiToSeconds(time));
+        tempoTimes.push_back(time);
+        tempoUsecs.push_back(data[meta]);
+    }
+}
+
+void PlayTimeline::clearTempoMap() {
+    tempoTimes.assign(1, 0);
+    tempoSeconds.assign(1, 0);
+    tempoUsecs.assign(1, stdMSecsPerQuarterNote);
+}
+
+// voice to take when all voices on channel are busy; over holds gate on for each voice
+unsigned PlayTimeline::stealVoice(NoteTakerChannel::Steal steal, const unsigned* over) const {
+    unsigned result = 0;
+    for (unsigned voice = 1; voice < VOICE_COUNT; ++voice) {
+        unsigned test = over[voice];
+        unsigned best = over[result];
+        bool older = times[test] < times[best];
+        if (NoteTakerChannel::Steal::quietest == steal) {
+            if (velocities[test] < velocities[best]
+                    || (velocities[test] == velocities[best] && older)) {
+                result = voice;
+            }
+        } else if (older) {
+            result = voice;
+        }
+    }
+    return result;
+}
+
+void PlayTimeline::clear() {
+    times.clear();
+    ends.clear();
+    noteIndex.clear();
+    data.clear();
+    cvs.clear();
+    velocities.clear();
+    types.clear();
+    channels.clear();
+    voices.clear();
+    maxEnds.clear();
+    metas.clear();
+    noteStarts.clear();
+    noteEnds.clear();
+    keys.clear();
+    voiceCounts.fill(0);
+    this->clearTempoMap();
+}
+
+void PlayTimeline::reserve(size_t count) {
+    times.reserve(count);
+    ends.reserve(count);
+    noteIndex.reserve(count);
+    data.reserve(count);
+    cvs.reserve(count);
+    velocities.reserve(count);
+    types.reserve(count);
+    channels.reserve(count);
+    voices.reserve(count);
+    maxEnds.reserve(count);
+    noteStarts.reserve(count);
+    noteEnds.reserve(count);
+    keys.reserve(count);
+}
+
+int PlayTimeline::selectionEnd(unsigned selectStart, unsigned selectEnd, bool toSongEnd) const {
+    if (noteEnds.empty()) {
+        return 0;
+    }
+    if (toSongEnd || selectEnd >= noteEnds.size()) {
+        return noteEnds.back();
+    }
+    int result = noteEnds[selectStart];
+    for (unsigned event = this->noteToEvent(selectStart + 1);
+            event < this->size() && noteIndex[event] < selectEnd; ++event) {
+        if (PlayType::gateOn == types[event]) {
+            result = std::max(result, ends[event]);
+        }
+    }
+    return result;
+}
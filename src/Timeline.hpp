@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Channel.hpp"
+#include "Notes.hpp"
+
+// events process() acts upon; notes and rests that don't change outputs are omitted
+enum class PlayType : uint8_t {
+    header,         // first event; playStart of zero means nothing is playing
+    gateOff,
+    gateOn,
+    tempo,
+    keySignature,
+    timeSignature,
+    trackEnd,
+};
+
+// fingerprint of each note's fields that change playback, computed once per build; timelines
+// keep these rather than a copy of the notes, to find the first note an edit changed, and to
+// find a timeline already built from equal notes
+struct PlayKeys {
+    vector<uint64_t> keys;  // one per note
+    size_t hash = 0;        // of keys, ppq, and channel policies
+
+    PlayKeys(const Notes& , const array<NoteTakerChannel, CHANNEL_COUNT>& );
+};
+
+// playback compiled from notes: immutable once built
+// built by the ui thread whenever the slot is invalidated, so that the audio thread only
+// advances an index instead of walking display notes, testing type, channel, and end time
+// slots in every note taker holding the same score share one timeline; see slot storage
+// stored as structure of arrays: entry n of each vector describes event n
+struct PlayTimeline {
+    vector<int> times;          // midi time event occurs
+    vector<int> ends;           // gate on: midi time note ends; otherwise, same as time
+    vector<unsigned> noteIndex; // index into notes of note generating event; ascending
+    vector<int> data;           // gate on: voices in use on channel, including this one;
+                                // gate off: index of gate on; tempo: usecs per quarter note;
+                                // time signature: midi ticks per bar
+    vector<float> cvs;          // gate on: pitch in volts/octave, middle C at zero volts
+    vector<float> velocities;   // gate on: note on velocity
+    vector<PlayType> types;
+    vector<uint8_t> channels;
+    vector<uint8_t> voices;
+    vector<int> maxEnds;        // largest end of this and prior events; ascending
+    vector<unsigned> metas;     // indices of tempo, key signature, and time signature events
+    vector<int> noteStarts;     // indexed by note: start time of every note, including rests
+    vector<int> noteEnds;       // indexed by note: end time of every note
+    vector<uint64_t> keys;      // play keys of notes built from; compared to reuse events
+    // tempo map: entry n describes the span from one tempo change to the next
+    vector<int> tempoTimes;     // midi time tempo takes effect; first is zero; ascending
+    vector<double> tempoSeconds;  // seconds into score when tempo takes effect
+    vector<int> tempoUsecs;     // microseconds per quarter note
+    array<unsigned, CHANNEL_COUNT> voiceCounts;
+    array<NoteTakerChannel::Allocate, CHANNEL_COUNT> allocates;   // voice policies built with
+    array<NoteTakerChannel::Steal, CHANNEL_COUNT> steals;
+    int ppq = stdTimePerQuarterNote;
+
+    PlayTimeline() {
+        voiceCounts.fill(0);
+        allocates.fill(NoteTakerChannel::Allocate::lowestFree);
+        steals.fill(NoteTakerChannel::Steal::oldest);
+        this->clearTempoMap();
+    }
+
+    void build(const Notes& , const PlayKeys& , const array<NoteTakerChannel, CHANNEL_COUNT>& ,
+            const PlayTimeline* prior = nullptr);
+
+    void build(const Notes& n, const array<NoteTakerChannel, CHANNEL_COUNT>& channelPolicies,
+            const PlayTimeline* prior = nullptr) {
+        this->build(n, PlayKeys(n, channelPolicies), channelPolicies, prior);
+    }
+
+    bool builtFrom(const PlayKeys& , int ppq,
+            const array<NoteTakerChannel, CHANNEL_COUNT>& ) const;
+    void clear();
+    std::string debugString(unsigned index) const;
+
+    // gate on event at time on channel with pitch cv, or INT_MAX if there is none
+    unsigned findGateOn(int time, unsigned channel, float cv) const {
+        for (unsigned event = std::lower_bound(times.begin(), times.end(), time) - times.begin();
+                event < this->size() && times[event] == time; ++event) {
+            if (PlayType::gateOn == types[event] && channel == channels[event]
+                    && cv == cvs[event]) {
+                return event;
+            }
+        }
+        return INT_MAX;
+    }
+
+    // seconds into score at midi time, following tempo changes; exact to double precision
+    double midiToSeconds(double midiTime) const {
+        unsigned span = std::upper_bound(tempoTimes.begin(), tempoTimes.end(), midiTime)
+                - tempoTimes.begin() - 1;
+        return tempoSeconds[span]
+                + (midiTime - tempoTimes[span]) * tempoUsecs[span] / (ppq * 1000000.);
+    }
+
+    // fractional midi time at seconds into score; inverse of midi to seconds
+    double secondsToMidi(double seconds) const {
+        unsigned span = std::upper_bound(tempoSeconds.begin(), tempoSeconds.end(), seconds)
+                - tempoSeconds.begin() - 1;
+        return tempoTimes[span]
+                + (seconds - tempoSeconds[span]) * (ppq * 1000000.) / tempoUsecs[span];
+    }
+
+    // seconds per midi tick at tempo in effect at midi time
+    double secondsPerTick(double midiTime) const {
+        unsigned span = std::upper_bound(tempoTimes.begin(), tempoTimes.end(), midiTime)
+                - tempoTimes.begin() - 1;
+        return tempoUsecs[span] / (ppq * 1000000.);
+    }
+
+    // midi time reached at seconds into score; a time converted to seconds and back
+    // returns the same time, rather than one tick earlier from rounding
+    int secondsToMidiTime(double seconds) const {
+        return (int) std::floor(this->secondsToMidi(seconds) + 1e-6);
+    }
+
+    // first event generated by note at index, or after it if note generates none
+    unsigned noteToEvent(unsigned index) const {
+        return std::lower_bound(noteIndex.begin(), noteIndex.end(), index) - noteIndex.begin();
+    }
+
+    // first event not expired at midi time; every event before it has ended
+    unsigned seek(int midiTime) const {
+        return std::upper_bound(maxEnds.begin(), maxEnds.end(), midiTime) - maxEnds.begin();
+    }
+
+    // midi time playing selection stops: end of longest note in selection, or end of song
+    int selectionEnd(unsigned selectStart, unsigned selectEnd, bool toSongEnd) const;
+
+    unsigned size() const {
+        return types.size();
+    }
+
+private:
+    void add(PlayType type, const DisplayNote& note, unsigned index, int eventData = 0) {
+        times.push_back(note.startTime);
+        ends.push_back(PlayType::gateOn == type ? note.endTime() : note.startTime);
+        noteIndex.push_back(index);
+        data.push_back(eventData);
+        cvs.push_back(PlayType::gateOn == type ? -60.f / 12 + note.pitch() / 12.f : 0);
+        velocities.push_back(PlayType::gateOn == type ? (float) note.onVelocity() : 0);
+        maxEnds.push_back(std::max(maxEnds.empty() ? 0 : maxEnds.back(), ends.back()));
+        types.push_back(type);
+        channels.push_back(note.channel);
+        voices.push_back(0);
+    }
+
+    void buildTempoMap();
+    void clearTempoMap();
+    void copyPrefix(const PlayTimeline& prior, unsigned first);
+    void reserve(size_t count);
+    unsigned stealVoice(NoteTakerChannel::Steal , const unsigned* over) const;
+};
@@ -4,8 +4,10 @@
 
 #include "Button.hpp"
 #include "Display.hpp"
+#include "MakeMidi.hpp"
 #include "ParseMidi.hpp"
 #include "Taker.hpp"
+#include "Timeline.hpp"
 #include "Wheel.hpp"
 #include "Widget.hpp"
 
@@ -287,7 +289,8 @@ static void Expected(NoteTakerWidget* n) {
 
 static void TestEncode() {
     Notes n;
-    n.notes.clear();
+    auto& notes = n.notes.edit();
+    notes.clear();
     int start = 0;
     for (auto type : { MIDI_HEADER, KEY_SIGNATURE, TIME_SIGNATURE, MIDI_TEMPO, NOTE_ON, NOTE_OFF,
             REST_TYPE, TRACK_END }) {
@@ -299,7 +302,7 @@ static void TestEncode() {
             note.setPitchData(60);
         }
         start += note.duration;
-        n.notes.push_back(note);
+        notes.push_back(note);
     }
     vector<std::string> results;
     for (const auto& note : n.notes) {
@@ -321,7 +324,9 @@ static void TestEncode() {
     DEBUG("raw midi2");
     NoteTakerParseMidi::DebugDumpRawMidi(midi);
     Notes n2;
-    bool result = Notes::Deserialize(midi, &n2.notes, &n2.ppq);
+    vector<DisplayNote> deserialized;
+    bool result = Notes::Deserialize(midi, &deserialized, &n2.ppq);
+    n2.notes.assign(std::move(deserialized));
     vector<std::string> results2;
     for (const auto& note : n2.notes) {
         results2.push_back(note.debugString());
@@ -331,12 +336,191 @@ static void TestEncode() {
     SCHMICKLE(results == results2);
 }
 
+// a chord whose notes end together gets a note off for each, and a tempo change after the
+// chord ends is written after those note offs, not before
+static void TestMakeMidi() {
+    NoteTakerSlot slot;
+    auto& notes = slot.n.notes.edit();
+    notes.clear();
+    int ppq = slot.n.ppq;
+    notes.emplace_back(MIDI_HEADER);
+    for (int pitch : { 60, 64, 67 }) {
+        notes.emplace_back(NOTE_ON, 0, ppq);
+        notes.back().setPitchData(pitch);
+    }
+    notes.emplace_back(MIDI_TEMPO, ppq * 2);
+    notes.emplace_back(NOTE_ON, ppq * 2, ppq);
+    notes.back().setPitchData(72);
+    notes.emplace_back(TRACK_END, ppq * 3);
+    vector<uint8_t> midi;
+    NoteTakerMakeMidi maker;
+    maker.createFromNotes(slot, midi);  // asserts if any delta is negative
+    SCHMICKLE(midi.size() <= NoteTakerMakeMidi::MaxSize(slot));
+    FILE* file = tmpfile();
+    SCHMICKLE(file);
+    NoteTakerMakeMidi streamer;
+    size_t written = streamer.writeFromNotes(slot, file);
+    vector<uint8_t> streamed(written);
+    rewind(file);
+    SCHMICKLE(fread(streamed.data(), 1, written, file) == written);
+    fclose(file);
+    SCHMICKLE(streamed == midi);
+    NoteTakerSlot parsed;
+    vector<DisplayNote> parsedNotes;
+    NoteTakerParseMidi parser(midi, &parsedNotes, &parsed.n.ppq, &parsed.channels);
+    SCHMICKLE(parser.parseMidi());
+    parsed.n.notes.assign(std::move(parsedNotes));
+    vector<const DisplayNote*> ons;
+    int tempoTime = -1;
+    for (const auto& note : parsed.n.notes) {
+        if (NOTE_ON == note.type) {
+            ons.push_back(&note);
+        } else if (MIDI_TEMPO == note.type) {
+            tempoTime = note.startTime;
+        }
+    }
+    SCHMICKLE(4 == ons.size());
+    for (unsigned index = 0; index < 3; ++index) {
+        SCHMICKLE(0 == ons[index]->startTime);
+        SCHMICKLE(ppq == ons[index]->duration);  // would run to the end if its off was lost
+    }
+    SCHMICKLE(ppq * 2 == ons[3]->startTime);
+    SCHMICKLE(ppq == ons[3]->duration);
+    SCHMICKLE(ppq * 2 == tempoTime);
+}
+
+// a timeline built from one with the same leading notes reuses its events; the result must
+// match a timeline built from scratch, and record what it was built from
+static void TestTimelineReuse() {
+    Notes n;
+    auto& notes = n.notes.edit();
+    notes.clear();
+    int ppq = n.ppq;
+    notes.emplace_back(MIDI_HEADER);
+    for (int index = 0; index < 16; ++index) {
+        uint8_t chan = index & 1;
+        notes.emplace_back(NOTE_ON, index / 2 * ppq, ppq * (1 + chan), chan);
+        notes.back().setPitchData(60 + index);
+    }
+    notes.emplace_back(TRACK_END, 9 * ppq);
+    array<NoteTakerChannel, CHANNEL_COUNT> chans;
+    PlayTimeline prior;
+    prior.build(n, chans);
+    Notes edited = n;
+    edited.notes.edit()[11].duration += ppq / 2;
+    PlayTimeline fresh;
+    fresh.build(edited, chans);
+    PlayTimeline reused;
+    reused.build(edited, chans, &prior);
+    SCHMICKLE(fresh.times == reused.times);
+    SCHMICKLE(fresh.ends == reused.ends);
+    SCHMICKLE(fresh.noteIndex == reused.noteIndex);
+    SCHMICKLE(fresh.data == reused.data);
+    SCHMICKLE(fresh.cvs == reused.cvs);
+    SCHMICKLE(fresh.velocities == reused.velocities);
+    SCHMICKLE(fresh.types == reused.types);
+    SCHMICKLE(fresh.channels == reused.channels);
+    SCHMICKLE(fresh.voices == reused.voices);
+    SCHMICKLE(fresh.maxEnds == reused.maxEnds);
+    SCHMICKLE(fresh.metas == reused.metas);
+    SCHMICKLE(fresh.keys == reused.keys);
+    SCHMICKLE(fresh.voiceCounts == reused.voiceCounts);
+    PlayKeys keys(edited, chans);
+    SCHMICKLE(reused.builtFrom(keys, edited.ppq, chans));
+    SCHMICKLE(!prior.builtFrom(keys, edited.ppq, chans));
+    SCHMICKLE(prior.builtFrom(PlayKeys(n, chans), n.ppq, chans));
+    chans[0].allocate = NoteTakerChannel::Allocate::roundRobin;
+    SCHMICKLE(!reused.builtFrom(PlayKeys(edited, chans), edited.ppq, chans));
+}
+
+// two tracks play the same notes at different velocities, so every note ties with one from
+// the other track; merged notes must be in display order, with ties taken in file order
+// the tracks are long enough that larger machines parse them concurrently
+static void TestMergeTracks() {
+    const unsigned noteCount = 3000;
+    const int ppq = 96;
+    vector<uint8_t> midi = { 'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 1, 0, 2, 0, ppq };
+    for (uint8_t velocity : { 100, 50 }) {
+        const uint8_t header[] = { 'M', 'T', 'r', 'k', 0, 0, 0, 0 };
+        midi.insert(midi.end(), header, header + sizeof(header));
+        size_t start = midi.size();
+        for (unsigned index = 0; index < noteCount; ++index) {
+            uint8_t pitch = 48 + index % 24;
+            const uint8_t note[] = { 0, 0x90, pitch, velocity, ppq / 2, 0x80, pitch, 0x40 };
+            midi.insert(midi.end(), note, note + sizeof(note));
+        }
+        const uint8_t trackEnd[] = { 0, 0xFF, 0x2F, 0 };
+        midi.insert(midi.end(), trackEnd, trackEnd + sizeof(trackEnd));
+        size_t length = midi.size() - start;
+        for (unsigned index = 0; index < 4; ++index) {
+            midi[start - 1 - index] = length >> (index * 8);
+        }
+    }
+    vector<DisplayNote> notes;
+    int parsedPpq;
+    array<NoteTakerChannel, CHANNEL_COUNT> chans;
+    NoteTakerParseMidi parser(midi, &notes, &parsedPpq, &chans);
+    SCHMICKLE(parser.parseMidi());
+    SCHMICKLE(ppq == parsedPpq);
+    vector<const DisplayNote*> ons;
+    for (unsigned index = 0; index < notes.size(); ++index) {
+        SCHMICKLE(!index || !(notes[index] < notes[index - 1]));
+        if (NOTE_ON == notes[index].type) {
+            ons.push_back(&notes[index]);
+        }
+    }
+    SCHMICKLE(noteCount * 2 == ons.size());
+    for (unsigned index = 0; index < ons.size(); index += 2) {
+        SCHMICKLE(*ons[index] == *ons[index + 1]);
+        SCHMICKLE(100 == ons[index]->onVelocity());
+        SCHMICKLE(50 == ons[index + 1]->onVelocity());
+    }
+}
+
+// slots that load the same score hold one copy of its notes; editing one slot copies them,
+// leaving the others unchanged
+static void TestShareNotes() {
+    vector<DisplayNote> score = { DisplayNote(MIDI_HEADER), DisplayNote(NOTE_ON, 0, 96),
+            DisplayNote(TRACK_END, 96) };
+    score[1].setPitchData(60);
+    Notes first;
+    first.notes.assign(vector<DisplayNote>(score));
+    first.notes.share();
+    Notes second;
+    second.notes.assign(vector<DisplayNote>(score));
+    second.notes.share();
+    SCHMICKLE(first.notes.sharedWith(second.notes));
+    Notes copied = first;
+    SCHMICKLE(copied.notes.sharedWith(first.notes));
+    second.notes.edit()[1].setPitchData(62);
+    SCHMICKLE(!second.notes.sharedWith(first.notes));
+    SCHMICKLE(copied.notes.sharedWith(first.notes));
+    SCHMICKLE(60 == first.notes[1].pitch());
+    SCHMICKLE(62 == second.notes[1].pitch());
+    Notes other;
+    other.notes.assign(vector<DisplayNote>(second.notes));
+    other.notes.share();
+    SCHMICKLE(!other.notes.sharedWith(first.notes));
+}
+
 void UnitTest(NoteTakerWidget* n, TestType test) {
     n->unitTestRunning = true;
     switch (test) {
         case TestType::encode:
             TestEncode();
             break;
+        case TestType::makeMidi:
+            TestMakeMidi();
+            break;
+        case TestType::timeline:
+            TestTimelineReuse();
+            break;
+        case TestType::mergeTracks:
+            TestMergeTracks();
+            break;
+        case TestType::shareNotes:
+            TestShareNotes();
+            break;
         case TestType::digit:
             LowLevelTestDigitsSolo(n);
             LowLevelTestDigits(n);
@@ -1,5 +1,6 @@
 #include "Button.hpp"
 #include "Display.hpp"
+#include "Library.hpp"
 #include "MakeMidi.hpp"
 #include "ParseMidi.hpp"
 #include "Taker.hpp"
@@ -82,13 +83,11 @@ struct DisplayBevel : Widget {
 
 };
 
-// move everything hanging off NoteTaker for inter-app communication and hang it off
-// NoteTakerWidget instead, 
+// module owns slots and playback, and runs without this widget; widget edits module's slots
 // make sure things like loading midi don't happen if module is null
 NoteTakerWidget::NoteTakerWidget(NoteTaker* module) 
-    : editButtonSize(Vec(22, 43)) {
-    reqs.reader = &reqs.buffer.front();
-    reqs.writer = &reqs.buffer.front();
+    : storage(module ? module->storage : ownStorage)
+    , editButtonSize(Vec(22, 43)) {
     if (debugVerbose) {
         NoteDurations::Validate();
     }
@@ -108,21 +107,6 @@ NoteTakerWidget::NoteTakerWidget(NoteTaker* module)
     this->addChild(createLight<SmallLight<ClipboardLight>>(Vec(RACK_GRID_WIDTH * 1.25f + 16,
             RACK_GRID_WIDTH * 11.8f), module, NoteTaker::CLIPBOARD_ON_LIGHT));
     if (module) {
-        module->configParam<RunButtonToolTip>(NoteTaker::RUN_BUTTON, 0, 1, 0, "Play");
-        module->configParam<SelectButtonToolTip>(NoteTaker::EXTEND_BUTTON, 0, 2, 0, "Notes");
-        module->configParam<InsertButtonToolTip>(NoteTaker::INSERT_BUTTON, 0, 1, 0, "Insert");
-        module->configParam<CutButtonToolTip>(NoteTaker::CUT_BUTTON, 0, 1, 0, "Cut");
-        module->configParam<RestButtonToolTip>(NoteTaker::REST_BUTTON, 0, 1, 0, "Insert");
-        module->configParam<PartButtonToolTip>(NoteTaker::PART_BUTTON, 0, 1, 0, "Part");
-        module->configParam<FileButtonToolTip>(NoteTaker::FILE_BUTTON, 0, 1, 0, "Load");
-        module->configParam<SustainButtonToolTip>(NoteTaker::SUSTAIN_BUTTON, 0, 1, 0, "Edit");
-        module->configParam<TimeButtonToolTip>(NoteTaker::TIME_BUTTON, 0, 1, 0, "Insert");
-        module->configParam<KeyButtonToolTip>(NoteTaker::KEY_BUTTON, 0, 1, 0, "Insert");
-        module->configParam<TieButtonToolTip>(NoteTaker::TIE_BUTTON, 0, 1, 0, "Add");
-        module->configParam<SlotButtonToolTip>(NoteTaker::SLOT_BUTTON, 0, 1, 0, "Edit");
-        module->configParam<TempoButtonToolTip>(NoteTaker::TEMPO_BUTTON, 0, 1, 0, "Insert");
-        module->configParam<HorizontalWheelToolTip>(NoteTaker::HORIZONTAL_WHEEL, 0, 1, 0, "Time Wheel");
-        module->configParam<VerticalWheelToolTip>(NoteTaker::VERTICAL_WHEEL, 0, 1, 0, "Pitch Wheel");
         module->setMainWidget(this);  // to do : is there a way to avoid this cross-dependency?
     }
     Vec hWheelPos = Vec(RACK_GRID_WIDTH * 7 - 50, RACK_GRID_WIDTH * 11.5f);
@@ -218,53 +202,118 @@ struct NoteTakerMidiItem : MenuItem {
     std::string directory;
 
 	void onAction(const event::Action& ) override {
-        auto slot = widget->activeSlot();
-        slot->directory = directory;
-        slot->filename = text;
-        slot->setFromMidi();
-        widget->resetScore();
+        widget->importMidi(directory, text);
 	}
 };
 
-// matches dot mid and dot midi, case insensitive
-static bool endsWithMid(const std::string& str) {
-    if (str.size() < 5) {
-        return false;
+struct NoteTakerCancelImportItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	void onAction(const event::Action& ) override {
+        widget->midiImport.cancel();
+        widget->display->redraw();
+	}
+};
+
+struct NoteTakerLibrarySortItem : MenuItem {
+    MidiLibrary::Sort sort;
+
+	void onAction(const event::Action& ) override {
+        MidiLibrary::Shared().sort = sort;
+	}
+};
+
+struct NoteTakerLibrarySortMenuItem : MenuItem {
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        const char* names[] = { "Name", "Newest", "Longest", "Most notes" };
+        for (unsigned index = 0; index < sizeof(names) / sizeof(names[0]); ++index) {
+            auto sort = (MidiLibrary::Sort) index;
+            auto item = createMenuItem<NoteTakerLibrarySortItem>(names[index],
+                    CHECKMARK(sort == MidiLibrary::Shared().sort));
+            item->sort = sort;
+            menu->addChild(item);
+        }
+		return menu;
+	}
+};
+
+// rack builds every item when a menu opens, so libraries with thousands of files are shown
+// a page at a time, each page ending with an item that opens the next
+const unsigned MIDI_MENU_PAGE = 100;
+
+template <class TMidiItem>
+void AddMidiPage(Menu* menu, NoteTakerWidget* widget,
+        const std::shared_ptr<const MidiLibrary::Entries>& entries,
+        const std::shared_ptr<const vector<const MidiLibraryEntry*>>& sorted, unsigned start);
+
+template <class TMidiItem>
+struct NoteTakerMidiPageItem : MenuItem {
+	NoteTakerWidget* widget;
+    std::shared_ptr<const MidiLibrary::Entries> entries;  // owns what sorted points to
+    std::shared_ptr<const vector<const MidiLibraryEntry*>> sorted;
+    unsigned start;
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        AddMidiPage<TMidiItem>(menu, widget, entries, sorted, start);
+		return menu;
+	}
+};
+
+template <class TMidiItem>
+void AddMidiPage(Menu* menu, NoteTakerWidget* widget,
+        const std::shared_ptr<const MidiLibrary::Entries>& entries,
+        const std::shared_ptr<const vector<const MidiLibraryEntry*>>& sorted, unsigned start) {
+    unsigned end = std::min((unsigned) sorted->size(), start + MIDI_MENU_PAGE);
+    for (unsigned index = start; index < end; ++index) {
+        auto entry = (*sorted)[index];
+        auto item = createMenuItem<TMidiItem>(entry->filename, entry->summary());
+        item->widget = widget;
+        item->directory = entry->directory;
+        menu->addChild(item);
     }
-    const char* last = &str.back();
-    if ('i' == tolower(*last)) {
-        --last;
+    if (end < sorted->size()) {
+        auto more = createMenuItem<NoteTakerMidiPageItem<TMidiItem>>(
+                "More (" + std::to_string(sorted->size() - end) + ")", RIGHT_ARROW);
+        more->widget = widget;
+        more->entries = entries;
+        more->sorted = sorted;
+        more->start = end;
+        menu->addChild(more);
     }
-    const char dotMid[] = ".mid";
-    const char* test = last - 3;
-    for (int index = 0; index < 3; ++index) {
-        if (dotMid[index] != tolower(test[index])) {
-            return false;
-        }
+}
+
+template <class TMidiItem>
+void AddMidiLibrary(Menu* menu, NoteTakerWidget* widget) {
+    auto& library = MidiLibrary::Shared();
+    library.refresh();
+    auto entries = library.entries();
+    if (entries->empty() && library.refreshing.load()) {
+        menu->addChild(createMenuLabel("Finding MIDI files..."));
     }
-    return true;
+    auto sorted = std::make_shared<const vector<const MidiLibraryEntry*>>(
+            library.sorted(*entries));
+    AddMidiPage<TMidiItem>(menu, widget, entries, sorted, 0);
 }
 
+// lists files from the library index, which is brought up to date in the background
+// each time the menu opens; files found since show the next time
 struct NoteTakerLoadItem : MenuItem {
 	NoteTakerWidget* widget;
 
 	Menu* createChildMenu() override {
 		auto menu = new Menu;
-        for (auto& dir : { asset::user("/"), SlotArray::UserDirectory() }) {
-            std::list<std::string> entries(system::getEntries(dir));
-            for (const auto& entry : entries) {
-                if (!endsWithMid(entry)) {
-                    continue;
-                }
-                size_t lastSlash = entry.rfind('/');
-                std::string filename = std::string::npos == lastSlash ? entry : entry.substr(lastSlash + 1);
-                auto item = new NoteTakerMidiItem;
-                item->text = filename;
-                item->widget = widget;
-                item->directory = dir;
-                menu->addChild(item);
-            }
+        if (widget->midiImport.busy()) {
+            auto cancelItem = createMenuItem<NoteTakerCancelImportItem>(
+                    "Cancel loading " + widget->midiImport.filename);
+            cancelItem->widget = widget;
+            menu->addChild(cancelItem);
+            menu->addChild(new MenuSeparator);
         }
+        menu->addChild(createMenuItem<NoteTakerLibrarySortMenuItem>("Sort by", RIGHT_ARROW));
+        AddMidiLibrary<NoteTakerMidiItem>(menu, widget);
 		return menu;
 	}
 };
@@ -283,7 +332,7 @@ struct NoteTakerSaveAsMidi : ui::TextField {
             auto slot = widget->activeSlot();
             slot->directory = SlotArray::UserDirectory();
             slot->filename = text;
-            if (!endsWithMid(slot->filename)) {
+            if (!MidiLibrary::IsMidiName(slot->filename)) {
                 slot->filename += ".mid";
             }
             slot->writeToMidi();
@@ -395,6 +444,299 @@ struct NoteTakerDebugDumpItem : MenuItem {
 	}
 };
 
+// renders score without rack's audio thread; see NoteTaker::render
+struct NoteTakerRenderMidiItem : MenuItem {
+	NoteTakerWidget* widget;
+    std::string directory;
+
+	void onAction(const event::Action& ) override {
+        widget->offlineRender.start(directory + text, SlotArray::UserDirectory() + text + ".csv");
+	}
+};
+
+struct NoteTakerCancelRenderItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	void onAction(const event::Action& ) override {
+        widget->offlineRender.cancel();
+	}
+};
+
+struct NoteTakerRenderLengthItem : MenuItem {
+	NoteTakerWidget* widget;
+    float seconds;
+
+	void onAction(const event::Action& ) override {
+        widget->offlineRender.seconds = seconds;
+	}
+};
+
+struct NoteTakerRenderRateItem : MenuItem {
+	NoteTakerWidget* widget;
+    float sampleRate;
+
+	void onAction(const event::Action& ) override {
+        widget->offlineRender.sampleRate = sampleRate;
+	}
+};
+
+struct NoteTakerRenderTimeSamplesItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	void onAction(const event::Action& ) override {
+        widget->offlineRender.timeSamples ^= true;
+	}
+};
+
+struct NoteTakerRenderLengthMenuItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        for (unsigned seconds : { 10, 60, 300, 1800 }) {
+            auto item = createMenuItem<NoteTakerRenderLengthItem>(seconds < 60 ?
+                    std::to_string(seconds) + " seconds" : std::to_string(seconds / 60) + " minutes",
+                    CHECKMARK(seconds == widget->offlineRender.seconds));
+            item->widget = widget;
+            item->seconds = seconds;
+            menu->addChild(item);
+        }
+		return menu;
+	}
+};
+
+struct NoteTakerRenderRateMenuItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        for (unsigned sampleRate : { 44100, 48000, 96000, 192000 }) {
+            auto item = createMenuItem<NoteTakerRenderRateItem>(std::to_string(sampleRate) + " Hz",
+                    CHECKMARK(sampleRate == widget->offlineRender.sampleRate));
+            item->widget = widget;
+            item->sampleRate = sampleRate;
+            menu->addChild(item);
+        }
+		return menu;
+	}
+};
+
+// lists files from the library index; writes a trace beside the user's saved files
+struct NoteTakerRenderItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        auto& render = widget->offlineRender;
+        if (render.busy()) {
+            auto cancelItem = createMenuItem<NoteTakerCancelRenderItem>("Cancel rendering",
+                    std::to_string((int) (render.fraction() * 100)) + "%");
+            cancelItem->widget = widget;
+            menu->addChild(cancelItem);
+            menu->addChild(new MenuSeparator);
+        }
+        auto lengthItem = createMenuItem<NoteTakerRenderLengthMenuItem>("Length", RIGHT_ARROW);
+        lengthItem->widget = widget;
+        menu->addChild(lengthItem);
+        auto rateItem = createMenuItem<NoteTakerRenderRateMenuItem>("Sample rate", RIGHT_ARROW);
+        rateItem->widget = widget;
+        menu->addChild(rateItem);
+        auto timeItem = createMenuItem<NoteTakerRenderTimeSamplesItem>("Time each sample",
+                CHECKMARK(render.timeSamples));
+        timeItem->widget = widget;
+        menu->addChild(timeItem);
+        menu->addChild(new MenuSeparator);
+        AddMidiLibrary<NoteTakerRenderMidiItem>(menu, widget);
+		return menu;
+	}
+};
+
+// voice policies apply to the channel being edited in the current slot
+struct NoteTakerAllocateItem : MenuItem {
+	NoteTakerWidget* widget;
+    NoteTakerChannel::Allocate allocate;
+
+	void onAction(const event::Action& ) override {
+        widget->storage.current().channels[widget->unlockedChannel()].allocate = allocate;
+        widget->invalAndPlay(Inval::load);
+	}
+};
+
+struct NoteTakerStealItem : MenuItem {
+	NoteTakerWidget* widget;
+    NoteTakerChannel::Steal steal;
+
+	void onAction(const event::Action& ) override {
+        widget->storage.current().channels[widget->unlockedChannel()].steal = steal;
+        widget->invalAndPlay(Inval::load);
+	}
+};
+
+struct NoteTakerVoicesItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        const auto& channel = widget->storage.current().channels[widget->unlockedChannel()];
+        const std::pair<const char*, NoteTakerChannel::Allocate> allocates[] = {
+            { "Lowest free voice", NoteTakerChannel::Allocate::lowestFree },
+            { "Round robin", NoteTakerChannel::Allocate::roundRobin },
+            { "Reuse voice for same pitch", NoteTakerChannel::Allocate::samePitch },
+        };
+        for (const auto& entry : allocates) {
+            auto item = createMenuItem<NoteTakerAllocateItem>(entry.first,
+                    CHECKMARK(entry.second == channel.allocate));
+            item->widget = widget;
+            item->allocate = entry.second;
+            menu->addChild(item);
+        }
+        menu->addChild(new MenuSeparator);
+        const std::pair<const char*, NoteTakerChannel::Steal> steals[] = {
+            { "Steal oldest note", NoteTakerChannel::Steal::oldest },
+            { "Steal quietest note", NoteTakerChannel::Steal::quietest },
+        };
+        for (const auto& entry : steals) {
+            auto item = createMenuItem<NoteTakerStealItem>(entry.first,
+                    CHECKMARK(entry.second == channel.steal));
+            item->widget = widget;
+            item->steal = entry.second;
+            menu->addChild(item);
+        }
+		return menu;
+	}
+};
+
+struct NoteTakerClockItem : MenuItem {
+	NoteTakerWidget* widget;
+    unsigned ppqn;
+    ClockFollower::Smoothing smoothing;
+
+	void onAction(const event::Action& ) override {
+        widget->nt()->requests.push({RequestType::setClockFollower,
+                ppqn << 8 | (unsigned) smoothing});
+	}
+};
+
+struct NoteTakerBlockSizeItem : MenuItem {
+	NoteTakerWidget* widget;
+    unsigned blockSize;
+
+	void onAction(const event::Action& ) override {
+        widget->nt()->requests.push({RequestType::setBlockSize, blockSize});
+	}
+};
+
+// how far ahead process() schedules note starts and ends, so samples that only play notes
+// skip reading requests, inputs, and tempo
+struct NoteTakerLookaheadItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        for (unsigned blockSize : { 1, 16, 32, 64, 128 }) {
+            auto item = createMenuItem<NoteTakerBlockSizeItem>(1 == blockSize ? "Off" :
+                    std::to_string(blockSize) + " samples",
+                    CHECKMARK(blockSize == widget->nt()->blockSize));
+            item->widget = widget;
+            item->blockSize = blockSize;
+            menu->addChild(item);
+        }
+		return menu;
+	}
+};
+
+// external clock input resolution and how closely tempo follows each edge
+struct NoteTakerClockFollowItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        const auto& follower = widget->nt()->clockFollower;
+        for (unsigned ppqn : { 1, 4, 24, 48 }) {
+            auto item = createMenuItem<NoteTakerClockItem>(std::to_string(ppqn) + " PPQN",
+                    CHECKMARK(ppqn == follower.ppqn));
+            item->widget = widget;
+            item->ppqn = ppqn;
+            item->smoothing = follower.smoothing;
+            menu->addChild(item);
+        }
+        menu->addChild(new MenuSeparator);
+        const std::pair<const char*, ClockFollower::Smoothing> smoothings[] = {
+            { "No smoothing", ClockFollower::Smoothing::none },
+            { "Light smoothing", ClockFollower::Smoothing::light },
+            { "Medium smoothing", ClockFollower::Smoothing::medium },
+            { "Heavy smoothing", ClockFollower::Smoothing::heavy },
+        };
+        for (const auto& entry : smoothings) {
+            auto item = createMenuItem<NoteTakerClockItem>(entry.first,
+                    CHECKMARK(entry.second == follower.smoothing));
+            item->widget = widget;
+            item->ppqn = follower.ppqn;
+            item->smoothing = entry.second;
+            menu->addChild(item);
+        }
+		return menu;
+	}
+};
+
+struct NoteTakerProfileClearItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	void onAction(const event::Action& ) override {
+        widget->nt()->profile.clearRequested.store(true, std::memory_order_release);
+	}
+};
+
+// writes every note taker's profile to the log, so the one spiking in a large patch stands out
+struct NoteTakerProfileLogItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	void onAction(const event::Action& ) override {
+        for (auto child : widget->parent->children) {
+            auto taker = dynamic_cast<NoteTakerWidget*>(child);
+            if (!taker || !taker->nt()) {
+                continue;
+            }
+            json_t* root = taker->nt()->profile.toJson();
+            char* dump = json_dumps(root, JSON_COMPACT);
+            DEBUG("note taker %d profile %s", taker->nt()->id, dump);
+            free(dump);
+            json_decref(root);
+        }
+	}
+};
+
+// time spent in process() by phase, and how much work it found, since last cleared
+struct NoteTakerProfileItem : MenuItem {
+	NoteTakerWidget* widget;
+
+	Menu* createChildMenu() override {
+		auto menu = new Menu;
+        const auto& profile = widget->nt()->profile;
+        for (unsigned phase = 0; phase < ProcessProfile::PHASE_COUNT; ++phase) {
+            menu->addChild(createMenuLabel(profile.summary((ProcessProfile::Phase) phase)));
+        }
+        menu->addChild(createMenuLabel("timed " + std::to_string(
+                profile.phases[ProcessProfile::total].count()) + " idle "
+                + std::to_string(profile.idleSamples.load(std::memory_order_relaxed))
+                + " in block " + std::to_string(profile.blockPlays.load(std::memory_order_relaxed))));
+        menu->addChild(createMenuLabel("events " + std::to_string(
+                profile.events.load(std::memory_order_relaxed)) + " notes "
+                + std::to_string(profile.notesStarted.load(std::memory_order_relaxed))));
+        menu->addChild(createMenuLabel("most queued: requests " + std::to_string(
+                profile.requestsMax.load(std::memory_order_relaxed)) + " replies "
+                + std::to_string(profile.notifyMax.load(std::memory_order_relaxed))));
+        menu->addChild(new MenuSeparator);
+        auto clearItem = createMenuItem<NoteTakerProfileClearItem>("Clear");
+        clearItem->widget = widget;
+        menu->addChild(clearItem);
+        auto logItem = createMenuItem<NoteTakerProfileLogItem>("Log all note takers as JSON");
+        logItem->widget = widget;
+        menu->addChild(logItem);
+		return menu;
+	}
+};
+
 void NoteTakerWidget::appendContextMenu(Menu *menu) {
     menu->addChild(new MenuEntry);
     auto loadItem = createMenuItem<NoteTakerLoadItem>("Load MIDI", RIGHT_ARROW);
@@ -409,6 +751,17 @@ void NoteTakerWidget::appendContextMenu(Menu *menu) {
     menu->addChild(quantizeItem);
     menu->addChild(createMenuItem<NoteTakerCompressJsonItem>("Compress JSON notes",
             CHECKMARK(compressJsonNotes)));
+    auto voicesItem = createMenuItem<NoteTakerVoicesItem>("Channel voices", RIGHT_ARROW);
+    voicesItem->widget = this;
+    menu->addChild(voicesItem);
+    if (this->nt()) {
+        auto clockItem = createMenuItem<NoteTakerClockFollowItem>("Clock input", RIGHT_ARROW);
+        clockItem->widget = this;
+        menu->addChild(clockItem);
+        auto lookaheadItem = createMenuItem<NoteTakerLookaheadItem>("Lookahead", RIGHT_ARROW);
+        lookaheadItem->widget = this;
+        menu->addChild(lookaheadItem);
+    }
     menu->addChild(new MenuSeparator);
     menu->addChild(createMenuItem<NoteTakerDebugVerboseItem>("Verbose debugging",
             CHECKMARK(debugVerbose)));
@@ -417,6 +770,14 @@ void NoteTakerWidget::appendContextMenu(Menu *menu) {
     menu->addChild(dumpItem);
     menu->addChild(createMenuItem<NoteTakerDebugCaptureItem>("Capture bug",
             CHECKMARK(debugCapture)));
+    auto renderItem = createMenuItem<NoteTakerRenderItem>("Render MIDI offline", RIGHT_ARROW);
+    renderItem->widget = this;
+    menu->addChild(renderItem);
+    if (this->nt()) {
+        auto profileItem = createMenuItem<NoteTakerProfileItem>("Process time", RIGHT_ARROW);
+        profileItem->widget = this;
+        menu->addChild(profileItem);
+    }
 
     // to do : add Marc Boule's reset options, approximately:
     /* Restart when run is -> turned off
@@ -488,18 +849,14 @@ void NoteTakerWidget::copyNotes() {
         onRef = false;
         clipboard.notes.push_back(src);
     } while (true);
-    for (auto& note : clipboard.notes) {
-        note.cache = nullptr;
-    }
     clipboardInvalid = false;
     this->setClipboardLight();
-    // iterate through parent and set all other note taker clipboards
+    // clipboard is shared; let every other note taker paste it
     for (auto child : parent->children) {
         auto taker = dynamic_cast<NoteTakerWidget*>(child);
         if (!taker || this == taker) {
             continue;
         }
-        taker->clipboard.notes = clipboard.notes;
         taker->clipboardInvalid = false;
         taker->setClipboardLight();
     }
@@ -524,19 +881,17 @@ void NoteTakerWidget::copySelectableNotes() {
 
         SCHMICKLE(TRACK_END != note.type);
         if (note.isSelectable(selectChannels)) {
-            note.cache = nullptr;
             clipboard.notes.push_back(std::move(note));
         }
     }
     clipboardInvalid = false;
     this->setClipboardLight();
-    // to do : iterate through parent and set all other note taker clipboards
+    // clipboard is shared; let every other note taker paste it
     for (auto child : parent->children) {
         auto taker = dynamic_cast<NoteTakerWidget*>(child);
         if (!taker || this == taker) {
             continue;
         }
-        taker->clipboard.notes = clipboard.notes;
         taker->clipboardInvalid = false;
         taker->setClipboardLight();
     }
@@ -546,9 +901,14 @@ void NoteTakerWidget::copyToSlot(unsigned index) {
     SCHMICKLE(index < storage.size());
     NoteTakerSlot* source = &storage.current();
     NoteTakerSlot* dest = &storage.slots[index];
-    // to do : create custom copy constructor to skip copying cache, and make cache non-copy-able
-    *dest = *source;
+    // copy only what the ui thread owns; the audio thread may be reading dest's timeline, so
+    // it is replaced by publishing a new one, and the old one is retired
+    dest->n = source->n;
+    dest->channels = source->channels;
+    dest->directory = source->directory;
+    dest->filename = source->filename;
     dest->invalid = true;
+    storage.buildTimeline(index);
 }
 
 void NoteTakerWidget::disableEmptyButtons() const {
@@ -684,12 +1044,31 @@ void NoteTakerWidget::invalAndPlay(Inval inval) {
     display->invalidateRange();
     if (Inval::display != inval) {
         display->invalidateCache();
+        storage.buildTimeline();
     }
     if (this->nt()) {
+        this->sendSelection();
         this->nt()->requests.push({RequestType::invalidateAndPlay, (unsigned) inval});
     }
 }
 
+// on clock input edge while editing, audio thread asks to insert note with v/oct pitch
+void NoteTakerWidget::insertFromClock(int duration, int midiNote) {
+    auto& n = this->n();
+    unsigned insertLoc = !n.noteCount(selectChannels) ? n.atMidiTime(0) :
+            !n.selectStart ? this->wheelToNote(1) : n.selectEnd;
+    int startTime = n.notes[insertLoc].startTime;
+    n.insertNote(insertLoc, startTime, duration, this->unlockedChannel(), midiNote);
+    this->insertFinal(duration, insertLoc, 1);
+}
+
+// reads file in the background into the active slot; step() takes the notes when ready
+void NoteTakerWidget::importMidi(const std::string& directory, const std::string& filename) {
+    unsigned slot = this->activeSlot() - &storage.slots.front();
+    midiImport.start(slot, directory, filename);
+    display->redraw();
+}
+
 void NoteTakerWidget::loadScore() {
     unsigned slot = (unsigned) horizontalWheel->getValue();
     SCHMICKLE(slot < storage.size());
@@ -861,18 +1240,21 @@ void NoteTakerWidget::setScoreEmpty() {
     makeMidi.createEmpty(emptyMidi);
     if (false && debugVerbose) NoteTakerParseMidi::DebugDumpRawMidi(emptyMidi);
     auto& slot = storage.current();
-    NoteTakerParseMidi emptyParser(emptyMidi, &slot.n.notes, nullptr, &slot.channels);
+    vector<DisplayNote> empty;
+    NoteTakerParseMidi emptyParser(emptyMidi, &empty, nullptr, &slot.channels);
     bool success = emptyParser.parseMidi();
     SCHMICKLE(success);
+    slot.n.notes.assign(std::move(empty));
     this->invalAndPlay(Inval::cut);
 }
 
 void NoteTakerWidget::setSelectableScoreEmpty() {
     auto& n = this->n();
-    auto iter = n.notes.begin();
-    while (iter != n.notes.end()) {
+    auto& notes = n.notes.edit();
+    auto iter = notes.begin();
+    while (iter != notes.end()) {
         if (iter->isSelectable(selectChannels)) {
-            iter = n.notes.erase(iter);
+            iter = notes.erase(iter);
         } else {
             ++iter;
         }
@@ -954,6 +1336,19 @@ bool NoteTakerWidget::setSelectStart(unsigned start) {
     return true;
 }
 
+// audio thread keeps its own copy of the widget state it plays from, so it never reads
+// notes being edited and runs without a widget
+void NoteTakerWidget::sendSelection() {
+    const auto& n = this->n();
+    auto& requests = this->nt()->requests;
+    runningSent = runButton->ledOn();
+    requests.push({RequestType::setRunning, runningSent});
+    requests.push({RequestType::setSlotStart, storage.slotStart});
+    requests.push({RequestType::setEditVoice, edit.voice});
+    requests.push({RequestType::setSelectStart, n.selectStart});
+    requests.push({RequestType::setSelectEnd, n.selectEnd});
+}
+
 void NoteTakerWidget::shiftNotes(unsigned start, int diff) {
     auto& n = this->n();
     if (debugVerbose) DEBUG("shift notes start %u diff %d selectChannels 0x%02x", start, diff, selectChannels);
@@ -972,6 +1367,7 @@ void NoteTakerWidget::stageSlot(unsigned slot) {
     display->stagedSlot = &storage.current();
     this->invalAndPlay(Inval::load);
     this->resetForPlay();
+    this->sendSelection();
     this->nt()->requests.push(RequestType::resetAndPlay);
 }
 
@@ -985,36 +1381,71 @@ void NoteTakerWidget::step() {
         selectButton->fb()->dirty = true;
         memcpy(lastTransform, t, sizeof(t));
     }
-    ReqRecord record;
-    do {
-        record = reqs.pop();
+    if (this->nt()) {
+        this->nt()->reqs.drain([this](const ReqRecord& record) {
 #if DEBUG_REQUEST
-        if (debugVerbose && ReqType::nothingToDo != record.type)
-            DEBUG("%s pop %s", __func__, record.debugStr().c_str());
+            if (debugVerbose)
+                DEBUG("step pop %s", record.debugStr().c_str());
 #endif
-        switch (record.type) {
-            case ReqType::resetDisplayRange:
-                display->range.reset();
-                break;
-            case ReqType::resetXAxisOffset:
-                display->range.resetXAxisOffset();
-                break;
-            case ReqType::runButtonActivate: {
-                event::DragEnd e;
-                runButton->onDragEnd(e);
-                } break;
-            case ReqType::setSelectStart:
-                (void) this->setSelectStart(record.data);
-                break;
-            case ReqType::stagedSlotStart:
-                storage.slotStart = record.data;
-                storage.slotEnd = record.data + 1;
-                display->slot = &storage.current();
-                break;
-            default:
-                assert(ReqType::nothingToDo == record.type);
+            switch (record.type) {
+                case ReqType::resetDisplayRange:
+                    display->range.reset();
+                    break;
+                case ReqType::resetXAxisOffset:
+                    display->range.resetXAxisOffset();
+                    break;
+                case ReqType::insertNote:
+                    this->insertFromClock(record.data >> 8, record.data & 0x7F);
+                    break;
+                case ReqType::runButtonActivate: {
+                    event::DragEnd e;
+                    runButton->onDragEnd(e);
+                    } break;
+                case ReqType::setSelectStart:
+                    (void) this->setSelectStart(record.data);
+                    break;
+                case ReqType::stagedSlotStart:
+                    // audio thread has already started playing slot; show it
+                    storage.slotStart = record.data;
+                    storage.slotEnd = record.data + 1;
+                    display->slot = &storage.current();
+                    display->invalidateRange();
+                    display->redraw();  // slot was laid out ahead of time by prepare next slot
+                    break;
+                default:
+                    assert(0);
+            }
+        });
+    }
+    if (midiImport.finished()) {
+        if (midiImport.take(&storage.slots[midiImport.slot])) {
+            // import may fill a slot other than the current one; invalAndPlay only
+            // rebuilds the current slot, so publish the imported slot's timeline here
+            storage.buildTimeline(midiImport.slot);
+            if (storage.slotStart == midiImport.slot) {
+                this->resetScore();
+            }
         }
-    } while (ReqType::nothingToDo != record.type);
+        display->redraw();
+    } else if (midiImport.busy()) {
+        display->redraw();  // advance progress
+    }
+    offlineRender.finished();
+    display->prepareNextSlot(!displayBuffer->fb->dirty);
+    storage.publishPlayback();
+    storage.reclaim();
+    if (this->nt() && runningSent != runButton->ledOn()) {
+        runningSent = runButton->ledOn();
+        this->nt()->requests.push({RequestType::setRunning, runningSent});
+    }
+    if (this->nt()) {
+        unsigned overflows = this->nt()->reqs.overflowCount()
+                + this->nt()->requests.overflowCount();
+        if (queueOverflows != overflows) {
+            DEBUG("request queues dropped %u records", overflows - queueOverflows);
+            queueOverflows = overflows;
+        }
+    }
     ModuleWidget::step();
 }
 
@@ -2,6 +2,8 @@
 
 #include "Button.hpp"
 #include "Edit.hpp"
+#include "Import.hpp"
+#include "Render.hpp"
 #include "Storage.hpp"
 
 struct CutButton;
@@ -13,73 +15,21 @@ struct NoteTakerDisplay;
 struct NoteTakerWheel;
 struct VerticalWheel;
 
-// circular buffer holds requests to modify widget state
-// taker thread writes to buffer and then advances writer pointer when done
-// widget thread reads from buffer and advances reader pointer when done
-enum class ReqType : unsigned {
-    nothingToDo,
-    resetDisplayRange,
-    resetXAxisOffset,
-    runButtonActivate,
-    setSelectStart,
-    stagedSlotStart,
-};
-
-struct ReqRecord {
-    ReqType type;
-    unsigned data;
-
-    std::string debugStr() const {
-        std::string result;
-        switch(type) {
-            case ReqType::nothingToDo: return "nothingToDo";
-            case ReqType::resetDisplayRange: return "resetDisplayRange";
-            case ReqType::resetXAxisOffset: return "resetXAxisOffset";
-            case ReqType::runButtonActivate: return "runButtonActivate";
-            case ReqType::setSelectStart: return "setSelectStart: " + std::to_string(data);
-            case ReqType::stagedSlotStart: return "stagedSlotStart: " + std::to_string(data);
-            default:
-                assert(0);  // incomplete
-        }
-        return "";
-    }
-};
-
-struct Reqs {
-    array<ReqRecord, 16> buffer;
-    ReqRecord* reader;
-    ReqRecord* writer;
-
-    ReqRecord pop() {
-        if (reader < writer) {
-            writer = &buffer.front();
-        }
-        if (reader == writer) {
-            return {ReqType::nothingToDo, INT_MAX};
-        }
-        return *writer++;
-    }
-
-    void push(const ReqRecord& record) {
-        ReqRecord* temp = reader == &buffer.back() ? &buffer.front() : reader;
-        *temp = record;
-        reader = temp + 1;
-    }
-
-    void push(ReqType type) {
-        this->push({type, 0});
-    }
-};
-
+// one clipboard is shared by every note taker, so notes cut in one paste into another
+// without each instance keeping its own copy
 struct Clipboard {
     vector<DisplayNote> notes;
     vector<SlotPlay> playback;
 
+    static Clipboard& Shared() {
+        static Clipboard shared;
+        return shared;
+    }
+
     void clear(bool slotOn) {
         slotOn ? resetSlots() : resetNotes();
     }
 
-    // to do : clear all clipboards on all instances of note taker
     void resetNotes() {
         notes.clear();
     }
@@ -91,17 +41,20 @@ struct Clipboard {
 
     bool fromJsonCompressed(json_t*, bool uncompressed);
     bool fromJsonUncompressed(json_t*);
+    bool playBackFromJson(json_t*);
     json_t* playBackToJson() const;
     void notesToJson(json_t* root) const;
 };
 
 struct NoteTakerWidget : ModuleWidget {
-    Reqs reqs;
     std::shared_ptr<Font> _musicFont = nullptr;
     std::shared_ptr<Font> _textFont = nullptr;
-    Clipboard clipboard;
-    SlotArray storage;
+    Clipboard& clipboard = Clipboard::Shared();
+    SlotArray ownStorage;   // used only if there is no module, as in the module browser
+    SlotArray& storage;     // module's slots, edited only by this widget
     NoteTakerEdit edit;
+    MidiImport midiImport;  // file being loaded from the context menu, if any
+    OfflineRender offlineRender;    // file being rendered from the context menu, if any
     CutButton* cutButton = nullptr;
     DisplayBuffer* displayBuffer = nullptr;
     FileButton* fileButton = nullptr;
@@ -121,7 +74,9 @@ struct NoteTakerWidget : ModuleWidget {
     VerticalWheel* verticalWheel = nullptr;
     const Vec editButtonSize;
     unsigned selectChannels = ALL_CHANNELS; // bit set for each active channel (all by default)
+    unsigned queueOverflows = 0;            // records dropped by request queues, last reported
     bool clipboardInvalid = true;
+    bool runningSent = false;               // run button state last sent to module
 #if RUN_UNIT_TEST
     bool runUnitTest = true;  // to do : ship with this disabled
     bool unitTestRunning = false;
@@ -149,6 +104,8 @@ struct NoteTakerWidget : ModuleWidget {
     unsigned getSlot() const;  // index of module slot, not influenced by file button or wheel
     void insertFinal(int duration, unsigned insertLoc, unsigned insertSize);
     void invalAndPlay(Inval );
+    void insertFromClock(int duration, int midiNote);
+    void importMidi(const std::string& directory, const std::string& filename);
     void loadScore();
 
     void makeSlurs();
@@ -226,6 +183,7 @@ struct NoteTakerWidget : ModuleWidget {
     void setSelectableScoreEmpty();
     bool setSelectEnd(int wheelValue, unsigned end);
     bool setSelectStart(unsigned start);
+    void sendSelection();
     void setVerticalWheelRange();
     void setWheelRange();
     void shiftNotes(unsigned start, int diff);